@@ -0,0 +1,102 @@
+//Stand-in for the Player of the game, only what program.cc uses (see bench.cc)
+//The types and the Dirs are the ones of the game, the rules are simplified
+#ifndef Player_hh
+#define Player_hh
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+using namespace std;
+
+enum Dir { Down, DR, Right, RU, Up, UL, Left, LD, DirSize };
+enum CellType { Street, Waste };
+enum UnitType { Alive, Dead, Zombie };
+
+struct Pos {
+	int i, j;
+	Pos() : i(0), j(0) {}
+	Pos(int i, int j) : i(i), j(j) {}
+};
+
+inline bool operator==(const Pos& a, const Pos& b) { return a.i == b.i and a.j == b.j; }
+inline bool operator!=(const Pos& a, const Pos& b) { return not (a == b); }
+inline bool operator<(const Pos& a, const Pos& b) { return a.i != b.i ? a.i < b.i : a.j < b.j; }
+inline ostream& operator<<(ostream& os, const Pos& p) { return os << "(" << p.i << "," << p.j << ")"; }
+
+inline Pos operator+(const Pos& p, Dir d) {
+	static const int di[DirSize] = {1, 1, 0, -1, -1, -1, 0, 1};
+	static const int dj[DirSize] = {0, 1, 1, 1, 0, -1, -1, -1};
+	return Pos(p.i + di[d], p.j + dj[d]);
+}
+
+struct Cell {
+	CellType type;
+	int owner;	//Player that conquered it, -1 if nobody
+	int id;	//Unit in it, -1 if none
+	bool food;
+};
+
+struct Unit {
+	UnitType type;
+	int id;
+	int player;	//-1 for Zombies
+	Pos pos;
+	int rounds_for_zombie;	//-1 if it's not going to turn
+};
+
+struct Game;
+
+class Player {
+	friend struct Game;
+	Game* game_ = nullptr;
+	int me_ = 0;
+	mt19937 rng_;
+
+public:
+	virtual ~Player() {}
+	virtual void play() = 0;
+
+	int me() const;
+	int num_players() const;
+	int num_rounds() const;
+	int round() const;
+	int board_rows() const;
+	int board_cols() const;
+	int rounds_before_becoming_zombie() const;
+	bool pos_ok(const Pos& p) const { return p.i >= 0 and p.j >= 0 and p.i < board_rows() and p.j < board_cols(); }
+	bool pos_ok(int i, int j) const { return pos_ok(Pos(i, j)); }
+	Cell cell(const Pos& p) const;
+	Cell cell(int i, int j) const { return cell(Pos(i, j)); }
+	Unit unit(int id) const;
+	int strength(int pl) const;
+	double status(int pl) const;	//Fraction of its CPU time the player has used
+	vector<int> alive_units(int pl) const;
+	vector<int> dead_units(int pl) const;
+	vector<int> zombies() const;
+	void move(int id, Dir d);
+
+	int random(int l, int u) { return uniform_int_distribution<int>(l, u)(rng_); }
+
+	vector<int> random_permutation(int n) {
+		vector<int> v(n);
+		for (int i = 0; i < n; ++i) v[i] = i;
+		shuffle(v.begin(), v.end(), rng_);
+		return v;
+	}
+};
+
+typedef Player* (*Factory)();
+void register_player(Factory f, const char* name);
+
+struct Registrar {
+	Registrar(Factory f, const char* name) { register_player(f, name); }
+};
+
+//Twice so that x is expanded first, as program.cc passes PLAYER_NAME
+#define RegisterPlayer(x) RegisterNamedPlayer(x)
+#define RegisterNamedPlayer(x) static Registrar registrar_##x(x::factory, #x)
+
+#endif
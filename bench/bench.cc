@@ -0,0 +1,452 @@
+//Plays program.cc against itself on synthetic boards and writes the latency and the allocations
+//of each play(), without the game of the course
+//	g++ -O2 -Ibench -o bench_player bench/bench.cc program.cc
+//	./bench_player [-m] [-s sizes] [-w walls] [-u units] [-z zombies] [-f food] [-r rounds] [-g games] [-S seed] [-t seconds]
+//e.g.	./bench_player -s 60,100,200,400 -w 0.1,0.3,maze
+//sizes are NxN or RxC, walls the fraction of Waste of each board or "maze" (corridors one cell
+//wide). units, zombies and food are for a board of 60x60 and grow with the area. Each size is
+//played with each kind of walls games times from seed on. seconds is the CPU time of each player
+//for the whole game, that status() tells (0 if there's no limit)
+//The 4 seats are the players registered (all the same one if program.cc is the only one), so two
+//variants compiled apart with other PLAYER_NAMEs can be compared too
+//With -m it plays matches instead (see tournament.sh): games games from seed on, each one on the
+//board of sizes x walls its seed picks and with the seats moved one variant each seed. It writes
+//a line for each seat of each game: seed, seat, variant, score (the cells it owned, added up
+//every round), share of the top score and p50 and p99 CPU ms of its rounds
+//The rules are the ones program.cc relies on, simplified: commands are done in the order each
+//player gave them, the players taking turns at random; units conquer the streets they step on,
+//eat food (+1 strength, cures the bite), kill Zombies and attack Enemies (the attacker wins with
+//its strength over both); the loser and the bitten units turn into Zombies after some rounds
+//(and come back somewhere else), and Zombies go to the nearest alive unit and bite it
+#include "Player.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <cstring>
+#include <new>
+#include <string>
+#include <sstream>
+#include <unistd.h>
+
+atomic<long long> allocations {0};	//Calls to operator new (program.cc reads it too with BENCHMARK)
+
+void* operator new(size_t size) {
+	++allocations;
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+
+//free() is right here, the operator new above mallocs
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+const int ZOMBIE_ROUNDS = 10;	//rounds_before_becoming_zombie()
+const int DEAD_ROUNDS = 5;	//Rounds a killed unit takes to turn
+const Dir DIRS[4] = {Down, Right, Up, Left};
+
+struct Registered {
+	Factory factory;
+	const char* name;
+};
+
+vector<Registered>& factories() {
+	static vector<Registered> f;
+	return f;
+}
+
+void register_player(Factory f, const char* name) {
+	factories().push_back(Registered {f, name});
+}
+
+struct Game {
+	int rows, cols, rounds, rnd = 0;
+	int P = 4;
+	double budget;	//CPU seconds of each player, 0 if there's no limit
+	vector<Cell> cells;	//Row-major
+	vector<Unit> units;
+	vector<bool> gone;	//Zombies killed
+	vector<int> strengths;
+	vector<long long> scores;	//Cells owned, added up every round
+	vector<double> used;	//Seconds of play() of each player
+	vector<vector<pair<int, Dir> > > commands;
+	vector<Player*> players;
+	vector<int> dist;	//Buffers of the Zombies
+	vector<int> queue;
+	mt19937 rng;
+
+	Game(int rows, int cols, int rounds, double budget, unsigned int seed) :
+		rows(rows), cols(cols), rounds(rounds), budget(budget), rng(seed) {
+		cells.assign(rows*cols, Cell {Street, -1, -1, false});
+		strengths.assign(P, 0);
+		scores.assign(P, 0);
+		used.assign(P, 0);
+		commands.resize(P);
+	}
+
+	~Game() {
+		for (Player* p : players) delete p;
+	}
+
+	void seat(Player* p, unsigned int seed) {
+		p->game_ = this;
+		p->me_ = players.size();
+		p->rng_.seed(seed);
+		players.push_back(p);
+	}
+
+	Cell& at(const Pos& p) {
+		return cells[p.i*cols + p.j];
+	}
+
+	bool inside(const Pos& p) const {
+		return p.i >= 0 and p.j >= 0 and p.i < rows and p.j < cols;
+	}
+
+	//Each cell is Waste with probability walls
+	void open_board(double walls) {
+		uniform_real_distribution<double> U(0, 1);
+		for (Cell& c : cells) if (U(rng) < walls) c.type = Waste;
+	}
+
+	//Corridors one cell wide between the cells of even row and column (depth first), with a few
+	//walls opened so that there are cycles
+	void maze_board() {
+		for (Cell& c : cells) c.type = Waste;
+		vector<Pos> stack = {Pos(0, 0)};
+		at(stack[0]).type = Street;
+		while (not stack.empty()) {
+			Pos p = stack.back();
+			Dir next[4];
+			int n = 0;
+			for (Dir d : DIRS) {
+				Pos q = p+d+d;
+				if (inside(q) and at(q).type == Waste) next[n++] = d;
+			}
+			if (n == 0) {
+				stack.pop_back();
+				continue;
+			}
+			Dir d = next[rng() % n];
+			at(p+d).type = at(p+d+d).type = Street;
+			stack.push_back(p+d+d);
+		}
+		for (int i = 0; i < rows; ++i)
+			for (int j = (i+1) % 2; j < cols; j += 2)
+				if (rng() % 20 == 0) at(Pos(i, j)).type = Street;
+	}
+
+	Pos free_street() {
+		while (true) {
+			Pos p(rng() % rows, rng() % cols);
+			Cell& c = at(p);
+			if (c.type == Street and c.id == -1 and not c.food) return p;
+	}	}
+
+	void add_unit(UnitType type, int player) {
+		Pos p = free_street();
+		int id = units.size();
+		units.push_back(Unit {type, id, player, p, -1});
+		gone.push_back(false);
+		at(p).id = id;
+		if (type == Alive) at(p).owner = player;
+	}
+
+	void add_food() {
+		at(free_street()).food = true;
+	}
+
+	//The attacker a wins with its strength over both (half the times if both are 0)
+	void fight(Unit& a, Unit& b) {
+		int sa = strengths[a.player], sb = strengths[b.player];
+		bool wins = sa+sb == 0 ? rng() % 2 == 0 : int(rng() % (sa+sb)) < sa;
+		Unit& loser = wins ? b : a;
+		loser.type = Dead;
+		loser.rounds_for_zombie = DEAD_ROUNDS;
+	}
+
+	void command(int pl, int id, Dir d) {
+		if (id < 0 or id >= int(units.size())) return;
+		Unit& u = units[id];
+		if (u.type != Alive or u.player != pl or (d != Down and d != Right and d != Up and d != Left)) return;
+		Pos q = u.pos+d;
+		if (not inside(q) or at(q).type == Waste) return;
+		Cell& c = at(q);
+		if (c.id == -1) {
+			at(u.pos).id = -1;
+			u.pos = q;
+			c.id = id;
+			c.owner = pl;
+			if (c.food) {
+				c.food = false;
+				++strengths[pl];
+				u.rounds_for_zombie = -1;
+				add_food();
+		}	}
+		else if (units[c.id].type == Zombie) {
+			gone[c.id] = true;
+			c.id = -1;
+		}
+		else if (units[c.id].type == Alive and units[c.id].player != pl) fight(u, units[c.id]);
+	}
+
+	//Only the first command of each unit counts, the players take turns at random
+	void do_commands() {
+		vector<size_t> next(P, 0);
+		vector<vector<bool> > done(P, vector<bool>(units.size(), false));
+		bool any = true;
+		while (any) {
+			any = false;
+			vector<int> order = {0, 1, 2, 3};
+			shuffle(order.begin(), order.end(), rng);
+			for (int pl : order) {
+				vector<pair<int, Dir> >& C = commands[pl];
+				while (next[pl] < C.size()) {
+					pair<int, Dir> m = C[next[pl]++];
+					if (m.first < 0 or m.first >= int(units.size()) or done[pl][m.first]) continue;
+					done[pl][m.first] = true;
+					command(pl, m.first, m.second);
+					any = true;
+					break;
+		}	}	}
+		for (auto& C : commands) C.clear();
+	}
+
+	//Zombies go down the distance to the nearest alive unit, and bite it if it's next to them
+	void move_zombies() {
+		dist.assign(rows*cols, -1);
+		queue.clear();
+		for (const Unit& u : units)
+			if (u.type == Alive) {
+				dist[u.pos.i*cols + u.pos.j] = 0;
+				queue.push_back(u.pos.i*cols + u.pos.j);
+		}
+		for (size_t h = 0; h < queue.size(); ++h) {
+			Pos p(queue[h] / cols, queue[h] % cols);
+			for (Dir d : DIRS) {
+				Pos q = p+d;
+				int k = q.i*cols + q.j;
+				if (inside(q) and at(q).type == Street and dist[k] == -1) {
+					dist[k] = dist[queue[h]] + 1;
+					queue.push_back(k);
+		}	}	}
+		for (Unit& z : units) {
+			if (z.type != Zombie or gone[z.id]) continue;
+			int here = dist[z.pos.i*cols + z.pos.j];
+			if (here == -1) continue;
+			int start = rng() % 4;
+			for (int i = 0; i < 4; ++i) {
+				Pos q = z.pos + DIRS[(start+i) % 4];
+				if (not inside(q) or at(q).type == Waste or dist[q.i*cols + q.j] != here-1) continue;
+				int o = at(q).id;
+				if (o == -1) {
+					at(z.pos).id = -1;
+					z.pos = q;
+					at(q).id = z.id;
+				}
+				else if (units[o].type == Alive and units[o].rounds_for_zombie == -1) units[o].rounds_for_zombie = ZOMBIE_ROUNDS;
+				break;
+	}	}	}
+
+	//The dead and the bitten units get nearer to turning. Each one that turns comes back as a new
+	//unit of its player somewhere else, so the players keep their units for the whole game
+	void turn() {
+		vector<int> back;
+		for (Unit& u : units)
+			if (not gone[u.id] and u.type != Zombie and u.rounds_for_zombie > 0 and --u.rounds_for_zombie == 0) {
+				back.push_back(u.player);
+				u.type = Zombie;
+				u.player = -1;
+				u.rounds_for_zombie = -1;
+		}
+		for (int pl : back) add_unit(Alive, pl);
+	}
+
+	void score() {
+		for (const Cell& c : cells) if (c.owner != -1) ++scores[c.owner];
+	}
+
+	void step() {
+		do_commands();
+		move_zombies();
+		turn();
+		score();
+		++rnd;
+	}
+};
+
+int Player::me() const { return me_; }
+int Player::num_players() const { return game_->P; }
+int Player::num_rounds() const { return game_->rounds; }
+int Player::round() const { return game_->rnd; }
+int Player::board_rows() const { return game_->rows; }
+int Player::board_cols() const { return game_->cols; }
+int Player::rounds_before_becoming_zombie() const { return ZOMBIE_ROUNDS; }
+Cell Player::cell(const Pos& p) const { return game_->cells[p.i*game_->cols + p.j]; }
+Unit Player::unit(int id) const { return game_->units[id]; }
+int Player::strength(int pl) const { return game_->strengths[pl]; }
+double Player::status(int pl) const { return game_->budget > 0 ? game_->used[pl]/game_->budget : 0; }
+void Player::move(int id, Dir d) { game_->commands[me_].push_back(make_pair(id, d)); }
+
+vector<int> Player::alive_units(int pl) const {
+	vector<int> v;
+	for (const Unit& u : game_->units) if (u.type == Alive and u.player == pl) v.push_back(u.id);
+	return v;
+}
+
+vector<int> Player::dead_units(int pl) const {
+	vector<int> v;
+	for (const Unit& u : game_->units) if (u.type == Dead and u.player == pl) v.push_back(u.id);
+	return v;
+}
+
+vector<int> Player::zombies() const {
+	vector<int> v;
+	for (const Unit& u : game_->units) if (u.type == Zombie and not game_->gone[u.id]) v.push_back(u.id);
+	return v;
+}
+
+//Returns the q-th quantile of v
+template <typename T> T quantile(vector<T> v, double q) {
+	sort(v.begin(), v.end());
+	return v[min(v.size()-1, size_t(q*v.size()))];
+}
+
+vector<string> split(const string& s) {
+	vector<string> v;
+	stringstream ss(s);
+	string x;
+	while (getline(ss, x, ',')) v.push_back(x);
+	return v;
+}
+
+//The board, the players in the seats (variant[pl] of the registered ones), their units, the
+//Zombies and the food of a game of seed. units, zombies and food are for a board of 60x60
+void set_up(Game& game, const string& wall, const vector<int>& variant, int units, int zombies, int food, unsigned int seed) {
+	double area = game.rows*game.cols/3600.0;
+	if (wall == "maze") game.maze_board();
+	else game.open_board(atof(wall.c_str()));
+	for (int pl = 0; pl < game.P; ++pl) {
+		game.seat(factories()[variant[pl]].factory(), seed*7 + pl);
+		for (int u = 0; u < max(1, int(units*area)); ++u) game.add_unit(Alive, pl);
+	}
+	for (int z = 0; z < int(zombies*area); ++z) game.add_unit(Zombie, -1);
+	for (int f = 0; f < int(food*area); ++f) game.add_food();
+}
+
+//Rows and columns of a size, NxN or RxC
+pair<int, int> dimensions(const string& size) {
+	int rows = atoi(size.c_str()), cols = rows;
+	if (size.find('x') != string::npos) cols = atoi(size.c_str() + size.find('x') + 1);
+	return make_pair(rows, cols);
+}
+
+//The matches of -m (see the top)
+void matches(const string& sizes, const string& walls, int units, int zombies, int food, int rounds,
+		int games, unsigned int seed, double seconds) {
+	vector<pair<string, string> > boards;
+	for (const string& size : split(sizes))
+		for (const string& wall : split(walls)) boards.push_back(make_pair(size, wall));
+	int n = factories().size();
+	printf("seed\tseat\tvariant\tscore\ttop\tp50_cpu_ms\tp99_cpu_ms\n");
+	for (int g = 0; g < games; ++g) {
+		unsigned int s = seed+g;
+		const pair<string, string>& board = boards[s % boards.size()];
+		pair<int, int> dim = dimensions(board.first);
+		Game game(dim.first, dim.second, rounds, seconds, s);
+		vector<int> variant(game.P);
+		for (int pl = 0; pl < game.P; ++pl) variant[pl] = (s+pl) % n;
+		set_up(game, board.second, variant, units, zombies, food, s);
+
+		vector<vector<double> > cpu(game.P);
+		for (int r = 0; r < rounds; ++r) {
+			for (int pl = 0; pl < game.P; ++pl) {
+				clock_t c = clock();
+				auto start = chrono::steady_clock::now();
+				game.players[pl]->play();
+				game.used[pl] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				cpu[pl].push_back(1000.0*(clock() - c)/CLOCKS_PER_SEC);
+			}
+			game.step();
+		}
+		long long top = *max_element(game.scores.begin(), game.scores.end());
+		int tied = count(game.scores.begin(), game.scores.end(), top);
+		for (int pl = 0; pl < game.P; ++pl)
+			printf("%u\t%d\t%s\t%lld\t%.3f\t%.3f\t%.3f\n", s, pl, factories()[variant[pl]].name, game.scores[pl],
+				game.scores[pl] == top ? 1.0/tied : 0.0, quantile(cpu[pl], 0.5), quantile(cpu[pl], 0.99));
+		fflush(stdout);
+}	}
+
+int main(int argc, char** argv) {
+	string sizes = "60,100,200,400", walls = "0.1,0.3,maze";
+	int units = 15, zombies = 20, food = 20, rounds = 200, games = 1;
+	unsigned int seed = 1;
+	double seconds = 0;
+	bool match = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "ms:w:u:z:f:r:g:S:t:")) != -1) {
+		if (opt == 'm') match = true;
+		else if (opt == 's') sizes = optarg;
+		else if (opt == 'w') walls = optarg;
+		else if (opt == 'u') units = atoi(optarg);
+		else if (opt == 'z') zombies = atoi(optarg);
+		else if (opt == 'f') food = atoi(optarg);
+		else if (opt == 'r') rounds = atoi(optarg);
+		else if (opt == 'g') games = atoi(optarg);
+		else if (opt == 'S') seed = atoi(optarg);
+		else if (opt == 't') seconds = atof(optarg);
+		else {
+			fprintf(stderr, "usage: %s [-m] [-s sizes] [-w walls] [-u units] [-z zombies] [-f food] [-r rounds] [-g games] [-S seed] [-t seconds]\n", argv[0]);
+			return 1;
+	}	}
+	if (factories().empty()) {
+		fprintf(stderr, "no player registered\n");
+		return 1;
+	}
+	if (match) {
+		matches(sizes, walls, units, zombies, food, rounds, games, seed, seconds);
+		return 0;
+	}
+
+	printf("%-9s %-6s %6s %8s %8s %8s %8s %7s %7s %7s %s\n", "board", "walls", "plays", "p50 ms", "p90 ms",
+		"p99 ms", "max ms", "allocs", "mean", "max", "strength/units of each seat");
+	for (const string& size : split(sizes))
+		for (const string& wall : split(walls)) {
+			int rows = dimensions(size).first, cols = dimensions(size).second;
+			vector<double> ms;
+			vector<long long> allocated;
+			string result;
+			for (int g = 0; g < games; ++g) {
+				Game game(rows, cols, rounds, seconds, seed+g);
+				vector<int> variant(game.P);
+				for (int pl = 0; pl < game.P; ++pl) variant[pl] = pl % factories().size();
+				set_up(game, wall, variant, units, zombies, food, seed+g);
+
+				for (int r = 0; r < rounds; ++r) {
+					for (int pl = 0; pl < game.P; ++pl) {
+						long long a = allocations;
+						auto start = chrono::steady_clock::now();
+						game.players[pl]->play();
+						double t = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+						a = allocations - a;
+						game.used[pl] += t/1000;
+						ms.push_back(t);
+						allocated.push_back(a);
+					}
+					game.step();
+				}
+				if (g == games-1)
+					for (int pl = 0; pl < game.P; ++pl)
+						result += " " + to_string(game.strengths[pl]) + "/" + to_string(game.players[pl]->alive_units(pl).size());
+			}
+			long long total = 0;
+			for (long long a : allocated) total += a;
+			printf("%-9s %-6s %6zu %8.3f %8.3f %8.3f %8.3f %7lld %7.1f %7lld%s\n", (to_string(rows) + "x" + to_string(cols)).c_str(),
+				wall.c_str(), ms.size(), quantile(ms, 0.5), quantile(ms, 0.9), quantile(ms, 0.99), quantile(ms, 1),
+				quantile(allocated, 0.5), double(total)/allocated.size(), quantile(allocated, 1), result.c_str());
+			fflush(stdout);
+	}
+}
@@ -1,18 +1,135 @@
 #include "Player.hh"
+#include <chrono>
+#include <climits>
 
 
 /**
  * Write the name of your player and save this file
  * with the same name and .cc extension.
  */
+#ifndef PLAYER_NAME	//tournament.sh compiles variants of this player with other names
 #define PLAYER_NAME Machinim4
+#endif
 
+#ifndef MAX_SEARCHERS	//All of them can be changed when compiling (-D) to try other values
 #define MAX_SEARCHERS 6	//Max # of units will chase the same food
+#endif
+#ifndef MAX_DISTANCE
 #define MAX_DISTANCE 50	//Max distance we will BFS
+#endif
+#ifndef MAX_TERRITORY
+#define MAX_TERRITORY 1000	//Max distance we will go to get new cells
+#endif
+#ifndef ROUND_TIME
+#define ROUND_TIME 20	//Milliseconds a round should take at most
+#endif
+#ifndef WALKER_INTEREST	//Extra distance of chasing each object (see bfs_find_units)
+#define WALKER_INTEREST 8
+#endif
+#ifndef ENEMY_INTEREST
+#define ENEMY_INTEREST 4
+#endif
+#ifndef CORPSE_INTEREST
+#define CORPSE_INTEREST 10
+#endif
+#ifndef ROLLOUTS
+#define ROLLOUTS 8	//Simulations of each move when we doubt about waiting
+#endif
+#ifndef MAX_ROLLOUTS
+#define MAX_ROLLOUTS 120	//Simulations of each round at most (5*ROLLOUTS for each doubt)
+#endif
+#ifndef HORIZON
+#define HORIZON 4	//Rounds simulated by each rollout
+#endif
+#ifndef THREAT_ROUNDS
+#define THREAT_ROUNDS 3	//Rounds ahead the Walkers are forecast
+#endif
+#define ZOMBIE_ROUNDS 5	//Rounds a beaten unit takes to turn in the simulations
 
 #define FIRST 0	//Used to assalt enemies if they are at distance 1
 #define SECOND 1	//Used to kill walkers or to get food
-#define LAST 3 //Used to assalt enemy if they are diagonal to me
+#define LAST 2 //Used to assalt enemy if they are diagonal to me
+
+//#define THREADS	//Runs the independent searches of a round at the same time
+//#define PROFILE	//Writes on cerr where the time goes at the end of the game
+//#define TRACE "trace.bin"	//Appends every decision to this file (read it with trace_reader.cc)
+
+#ifdef THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#endif
+
+#ifdef PROFILE
+#include <ctime>
+#include <numeric>
+#define PROFILE_TIMER(phase) Timer timer(this, phase);	//Times the rest of the block
+#define PROFILE_COUNT(counter) ++counters.back().counter
+#define PROFILE_TALLY(tally, counter) ++(tally).counter	//For the searches that can run in other threads
+#else
+#define PROFILE_TIMER(phase)
+#define PROFILE_COUNT(counter)
+#define PROFILE_TALLY(tally, counter)
+#endif
+
+#ifdef TRACE
+#include <cstdio>
+#include <cstdint>
+#define TRACE_TAGGER(phase) Tagger tagger(this, phase);	//Tags the moves decided in the rest of the block
+#define TRACE_AIM(id, target, distance) aim(id, target, distance)
+#else
+#define TRACE_TAGGER(phase)
+#define TRACE_AIM(id, target, distance)
+#endif
+
+#define PROFILE_PHASE(phase) PROFILE_TIMER(phase) TRACE_TAGGER(phase)
+
+#ifdef TRACE
+struct TraceRecord {	//A move decided by a unit, or the digest of a round (id == -1)
+	int32_t round;
+	int32_t id;
+	uint8_t player;
+	uint8_t phase;	//Phase of plan() that decided it
+	uint8_t priority;	//FIRST, SECOND or LAST
+	uint8_t dir;
+	int16_t i, j;	//Where the unit is going
+	int32_t distance;	//Steps to get there (plus the interest of what it chases)
+	uint32_t micros;	//Time plan() took (only in the digest)
+	uint64_t digest;	//Hash of the board (only in the digest)
+};
+static_assert(sizeof(TraceRecord) == 32, "trace_reader.cc expects records of 32 bytes");
+#endif
+
+//#define BENCHMARK 20	//Plans each round this many times and writes the latencies on cerr at the end
+//#define VERIFY	//Plans each round also with the first version's searches and compares the moves (see verify)
+
+#ifdef VERIFY
+#include <queue>
+#include <map>
+#include <set>
+#define VERIFY_NOTE(id, phase, distance) note(id, phase, distance)	//Why id moves, for verify
+#define ORIGINAL_SEEDS 8	//Times the original chases are searched, with other seeds (see original_chase)
+#else
+#define VERIFY_NOTE(id, phase, distance)
+#endif
+
+#ifdef BENCHMARK
+#include <atomic>
+
+//Calls to operator new of the whole program. They are weak, so several players compiled with
+//BENCHMARK can be in the same binary and bench/bench.cc can count them with its own
+atomic<long long> allocations __attribute__((weak)) {0};	//Atomic, as THREADS allocates too
+
+__attribute__((weak)) void* operator new(size_t size) {
+	++allocations;
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+
+__attribute__((weak)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((weak)) void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
 
 
 struct PLAYER_NAME : public Player {
@@ -29,7 +146,7 @@ struct PLAYER_NAME : public Player {
    * Types and attributes for your player can be defined here.
    */
 
-	enum Object {
+	enum Object : unsigned char {
 		Wall,
 		Enemy,
 		Walker,
@@ -41,44 +158,290 @@ struct PLAYER_NAME : public Player {
 		InterestObject
 	};
 
-	struct Movement {
-		int distance;
+	typedef vector<Object> layer;	//Row-major board with a border of Walls around it
+	typedef unsigned long long word;
+	typedef vector<word> bitboard;	//One bit for each cell of a layer
+	
+	typedef pair<int, Dir> mov;
+
+	struct Label {	//What the search from the interest objects knows about a cell
+		int src;	//Index in interest_pos of the nearest object
+		int distance;	//Steps from the object to the cell
+		Dir dir;	//First step to do from the cell to go to the object
+		bool open;	//If the search of the object goes on from the cell (it's not a unit that stops it)
+	};
+
+	struct Loss {	//Object that lost a unit in a pass of bfs_find_units (see lose_unit)
+		int src;
+		int steps;	//Steps from the object to the unit
+		int next;	//Position in losses of the next object that lost the same unit, -1 if none
+	};
+
+	struct Probe {	//Offset from a cell of board to another
+		int i, j;	//Rows and columns
+		int k;	//Index
+	};
+
+	struct Searcher {	//Unit found by bfs_find_units
+		int distance;	//Steps to its object (plus the interest of the object)
+		int id;
 		Dir dir;
-		Pos pos;
+		int src;
 	};
 
-	typedef vector<Object> row;
-	typedef vector<row> matrix;
-	
-	typedef pair<int, Dir> mov;
-	typedef pair<int, mov> priority;
-	typedef priority_queue<priority, vector<priority>, greater<priority> > p_q;
+#ifdef PROFILE
+	struct Tally {	//Counters of a search, added to the ones of the round when all the threads are done
+		long long nodes = 0;	//Cells expanded
+		long long pushes = 0;	//Cells queued
+	};
+#endif
+
+	static const int INTERESTS = 4;	//Food, Enemy, Walker and Corpse, see interest
+
+	struct Search {	//Buffers of a call to bfs_find_units, so several can run at the same time
+		vector<Label> label;	//Label of each cell k of board for each class c, at k*classes + c
+		vector<int> labelled;	//labelled[i] == stamp if label[i] is from the current search
+		int stamp = 0;
+		int classes = 1;	//Different interests of the objects (see bfs_find_units)
+		int class_interest[INTERESTS];	//Interest of each class
+		vector<int> class_of;	//Class of each object of interest_pos
+		vector<Label> retry_label;	//Same, for the passes that retry the lost units
+		vector<int> retry_labelled;	//retry_labelled[i] == pass if retry_label[i] is from the current pass
+		int pass = 0;	//Current pass, the first one or a retry (see bfs_find_units)
+		bool retrying = false;
+		bool checking = false;	//If the pass only measures the reach of one object (see reach)
+		vector<vector<int> > buckets;	//buckets[d] has the cells k to expand at distance d, as k*INTERESTS + class
+		vector<Searcher> searchers;	//Units found
+		vector<int> searcher_of;	//Position in searchers of each id (if searcher_stamp says so)
+		vector<int> searcher_stamp;
+		vector<int> units_found;	//# of units found from each object of interest_pos
+		vector<Loss> losses;	//Objects that first reached a unit from a cell next to a Walker
+		vector<int> lost_head;	//Position in losses of the last object that lost each id
+		vector<int> lost_stamp;	//lost_head[id] is from the current pass if lost_stamp[id] == pass
+		vector<int> lost_ids;	//Units lost in the current pass
+		vector<vector<int> > losers;	//Objects a retried unit is searched without, by id
+		vector<int> retried;	//losers[id] is from the current search if retried[id] == stamp
+		vector<int> retry;	//Units still to retry
+		vector<int> group;	//Units retried in the current pass
+		int unfound = 0;	//Units of group the current pass hasn't found yet
+		Pos low, high;	//Corners of the cells a retry pass searches (see searched)
+		vector<int> found_in;	//found_in[id] == pass if the current pass has found id
+		vector<int> excluded;	//excluded[src] == pass if the object src doesn't search in the pass
+		vector<int> wanted;	//wanted[id] == pass if a retry pass keeps what it finds of id
+		vector<int> reach;	//Steps at which each object finds more than SEARCHERS units searching alone
+		vector<int> reach_stamp;	//reach[src] is from the current search if reach_stamp[src] == stamp
+		unsigned int seed = 1;	//Its own random generator, so it doesn't depend on the others
+#ifdef PROFILE
+		Tally tally;
+#endif
+	};
+
+	struct Chase {	//Path of a unit to the object it chases, kept for the next round (see keep_chases)
+		int round = -1;	//round() it was followed for the last time
+		bool healthy = true;	//If the unit was healthy then
+		Object target = Nothing;	//What there was at the end of path
+		vector<int> path;	//Cells from the unit to the object (both included)
+		int step = 0;	//Position of the unit in path
+	};
+
+	struct Body {	//Unit of the simulator
+		int k;	//Index of its cell in board
+		Object type;	//Ally, Enemy, Walker, Corpse or Nothing (if it has been killed)
+		int player;
+		int rounds_for_zombie;
+	};
 
-	typedef pair<int, int> dist_id;
-	typedef priority_queue<dist_id, vector<dist_id>, greater<dist_id> > searchers_list;
+	struct Chain {	//Corridor between two junctions
+		int a, b;	//Index in junctions of its ends
+		int first;	//Position in chain_cells of its first cell (the one next to a)
+		int length;	//# of cells between a and b
+	};
 
-	matrix board;	//Board of the game
-	vector<Pos> food_pos;	//Vector with the food positions at the current round
+	layer board;	//Board of the game, (board_rows()+2) x (board_cols()+2) cells
+	bitboard layers[Nothing];	//layers[o] has the cells of board with o (Wall is only Waste)
+	bitboard objects[Nothing];	//layers once the menaces are considered (see write_masks)
+	bitboard adjacent[Nothing];	//Cells with some of objects[o] around them (also diagonal)
+	bitboard crossed[Nothing];	//Cells with some of objects[o] Up, Down, Right or Left
+	vector<int> streets;	//Indices of all the cells of board that are not Waste
+	vector<Object> kind;	//What is each unit of all_units (by id)
+	vector<int> unit_k;	//Cell of board of each unit (by id, like kind)
+	vector<int> unit_player;
+	vector<int> unit_zombie;	//rounds_for_zombie of each unit
+	vector<int> unit_in;	//Id of the unit in each cell of board (-1 if none)
+	vector<int> all_units;	//Ids of all the units of this round
+	vector<int> my_units;	//alive_units(me()) of this round
+	vector<float> win_rates;	//win_rate against each player this round
+	int round_stamp = 0;	//Changes every round
+	int stride = 0;	//Length of a row of board (border included)
+	int offset[DirSize];	//What to add to an index of board to move one step to each Dir
 	vector<Pos> walker_pos; //Vector with the walkers positions at the current round
-	vector<Pos> corpse_pos; //Vector with the corpse positions at the current round
-	vector<Pos> enemy_pos;
 	vector<Pos> interest_pos;
-	set<int> units_moved;	//Set with the IDs of all my units that has decided his move
-												//Not to move is also a move ;)
-	set<int> last_moved;
+	vector<int> units_moved;	//units_moved[id] == round_stamp if id has decided his move
+														//Not to move is also a move ;)
+	vector<int> last_moved;	//last_moved[id] == round_stamp if id waits for an Enemy
 	
-	p_q priority_movements;	//p_q with the movements ordered by priority of movement
+	vector<mov> priority_movements[LAST+1];	//Movements of each priority, in the order they were decided
+	vector<int> claimed;	//claimed[k] == round_stamp if an Ally is already going to the cell k
+	vector<int> leaving;	//leaving[k] == round_stamp if the Ally in k is going away
+	vector<unsigned char> leaving_priority;	//And the priority he does it with
 	const vector<Dir> Dirs = {Up, Right, Down, Left}; //All the moves a unit can do
 	int SEARCHERS = MAX_SEARCHERS;
 	int DISTANCE = MAX_DISTANCE;
+	int pressure = 0;	//How short of time we are, from 0 (relaxed) to 3 (only the basics)
+	chrono::steady_clock::time_point round_start;
+	double last_round_time = 0;	//Milliseconds the last round took
+
+	int orders[24][4];	//All the orders of {0, 1, 2, 3}
+	unsigned int seed = 1;	//State of the random generator of random_order
+	unsigned int round_seeds[4];	//Seeds of all the generators, drawn once per round
+	int seeded_round = -1;
+	bool reference = false;	//Plan with the first version of the searches instead of the fast ones (see verify)
+	bool fresh = false;	//Plan like the first version: no kept chases, forecast nor reserved cells (see verify)
+
+	vector<vector<Probe> > rings;	//rings[r] has the offsets of all the cells at distance r
+	vector<int> reached;	//reached[k] == reach_stamp if object_at_distance has reached k
+	int reach_stamp = 0;
+	vector<int> frontier, next_frontier;	//Cells at the current and next distance of a search
+
+	vector<Body> bodies;	//All the units at the beginning of this round (if sim_stamp == round_stamp)
+	vector<int> body_of;	//Index in bodies of each id
+	vector<int> occupant;	//Index in bodies of the unit in each cell of board (-1 if none)
+	int sim_stamp = 0;
+	vector<Body> arena;	//Units of the world being simulated, copied from bodies
+	vector<pair<int, int> > overlay;	//Cells whose occupant has changed in the world (last one wins)
+	int hero = -1;	//Index in arena of the unit we care about
+	vector<int> nearby;	//Indices in arena of the units that can meet hero in HORIZON rounds
+	int kills = 0;	//Walkers killed and Enemies beaten in the world by hero
+	int ROLLOUTS_LEFT = 0;	//Simulations that can still be done this round
+	unsigned int sim_seed = 1;
+
+	vector<int> prey;	//Distance from each cell to the nearest alive unit (if prey_stamp says so)
+	vector<int> prey_stamp;
+	vector<int> threat;	//First round a Walker may bite each cell (if threat_stamp says so)
+	vector<int> threat_stamp;
+	vector<int> threat_queue;
+
+	vector<int> territory;	//Distance from the cells next to my units to the nearest Square (-1 if too far)
+	int territory_limit = 0;	//Farthest distance in territory
+
+	vector<int> junctions;	//Streets that are not in a corridor (Waste never changes)
+	vector<int> junction_of;	//Index in junctions of each cell of board (-1 if it's not one)
+	vector<Chain> chains;
+	vector<int> chain_cells;	//Cells of all the corridors, each one from a to b
+	vector<int> chain_of;	//Corridor of each cell of board (-1 if none)
+	vector<int> chain_at;	//Position of each cell in its corridor (1..length)
+	vector<vector<int> > chains_of;	//Corridors that start or end at each junction
+	bool mazy = false;	//If true, territory is only written for the junctions (see territory_at)
+	vector<int> junction_distance;	//Distance from each junction to the nearest Square (-1 if too far)
+	vector<vector<int> > junction_buckets;
+	bitboard wanted, front_bits, next_bits, reached_bits;	//Buffers of write_territory
+
+	Search searches[2];	//For the healthy units and for the unhealthy ones
+#ifdef THREADS
+	//A thread kept for the whole game that does a task at a time, so no thread is started each round
+	struct Worker {
+		mutex m;
+		condition_variable cv;
+		function<void()> task;
+		bool busy = false;	//From run until the task is done
+		bool quit = false;
+		thread t = thread([this] { loop(); });	//The last member, it uses the others
+
+		~Worker() {
+			{
+				lock_guard<mutex> lock(m);
+				quit = true;
+			}
+			cv.notify_all();
+			t.join();
+		}
+
+		void loop() {
+			unique_lock<mutex> lock(m);
+			while (true) {
+				cv.wait(lock, [this] { return busy or quit; });
+				if (not busy) return;
+				lock.unlock();
+				task();
+				lock.lock();
+				busy = false;
+				cv.notify_all();
+		}	}
+
+		void run(function<void()> f) {
+			{
+				lock_guard<mutex> lock(m);
+				task = std::move(f);
+				busy = true;
+			}
+			cv.notify_all();
+		}
+
+		void wait() {
+			unique_lock<mutex> lock(m);
+			cv.wait(lock, [this] { return not busy; });
+		}
+	};
+	Worker searcher, expander;	//For the unhealthy units (see move_nearest_unit) and for the territory
+#endif
+#ifdef PROFILE
+	Tally territory_tally;	//Of write_territory
+#endif
+	vector<Searcher> searchers;	//Units found by both searches
+	vector<int> assigned;	//assigned[src] == stamp if some unit is already chasing it
+	int stamp = 0;
+	vector<Chase> chases;	//Last chase of each unit (by id)
+	vector<int> interest_at;	//Index in interest_pos of each cell, if interest_stamp[k] == round_stamp
+	vector<int> interest_stamp;
 
 	/**
 	 * Functions and methods
 	 */
 	
-	// Returns true if o is in position p, false otherwise
-	bool object_in(const Pos& p, const Object& o) {
-		return pos_ok(p) and board[p.i][p.j] == o;
+	//Index of p in board. p can be any position of the board or its border
+	inline int at(const Pos& p) const {
+		return (p.i+1)*stride + p.j+1;
+	}
+
+	//Position of the index k of board
+	inline Pos pos_of(int k) const {
+		return Pos(k/stride - 1, k%stride - 1);
+	}
+
+	inline bool test(const bitboard& b, int k) const {
+		return (b[k >> 6] >> (k & 63)) & 1;
+	}
+
+	inline void put(bitboard& b, int k, bool v) {
+		if (v) b[k >> 6] |= word(1) << (k & 63);
+		else b[k >> 6] &= ~(word(1) << (k & 63));
+	}
+
+	//dst |= src with every cell moved s indices forward (backward if s is negative)
+	void or_shifted(bitboard& dst, const bitboard& src, int s) {
+		int n = src.size();
+		int q = abs(s) >> 6, r = abs(s) & 63;
+		if (s >= 0) for (int i = n-1; i >= q; --i) {
+			word w = src[i-q] << r;
+			if (r and i-q > 0) w |= src[i-q-1] >> (64-r);
+			dst[i] |= w;
+		}
+		else for (int i = 0; i+q < n; ++i) {
+			word w = src[i+q] >> r;
+			if (r and i+q+1 < n) w |= src[i+q+1] << (64-r);
+			dst[i] |= w;
+	}	}
+
+	//dst = cells with some of src around them, only Up, Down, Right and Left if not diagonal
+	void spread(bitboard& dst, const bitboard& src, bool diagonal) {
+		dst.assign(src.size(), 0);
+		for (int d = 0; d < DirSize; ++d)
+			if (diagonal or d == Up or d == Down or d == Right or d == Left) or_shifted(dst, src, -offset[d]);
+	}
+
+	// Returns true if o is in position p, false otherwise (Wall are the cells I can't go)
+	inline bool object_in(const Pos& p, const Object& o) {
+		return test(objects[o], at(p));
 	}
 	
 	//Returns true if is in position p any of the objects in O
@@ -88,46 +451,101 @@ struct PLAYER_NAME : public Player {
 	}
 
 	bool is_wall(const Pos& p) {
-		return pos_ok(p) and cell(p).type == Waste;
+		return pos_ok(p) and board[at(p)] == Wall;
 	}
 	
 	// Returns true if a unit can move to that position 
-	bool can_move(const Pos& p) {
-		return pos_ok(p) and not object_in(p, Wall);
+	inline bool can_move(const Pos& p) {
+		return not test(objects[Wall], at(p));
 	}
 
-	bool object_crossed(const Pos& p, const Object& o) {
-		return	object_in(p+Up, o) or object_in(p+Down, o) or
-						object_in(p+Right, o) or object_in(p+Left, o);
+	//p must be inside the board, so all its neighbours are in board
+	inline bool object_crossed(const Pos& p, const Object& o) {
+		return test(crossed[o], at(p));
 	}
 	
 	//Returns true if there are Objects o adjacents to p
-	bool object_adjacent(const Pos& p, const Object& o) {
-		return	object_in(p+Up, o) or object_in(p+Down, o)
-						or object_in(p+Right, o) or object_in(p+Left, o)
-						or object_in(p+DR, o) or object_in(p+RU, o)
-						or object_in(p+UL, o) or object_in(p+LD, o); 
+	inline bool object_adjacent(const Pos& p, const Object& o) {
+		return test(adjacent[o], at(p));
 	}
 
 
 	bool object_adjacent(const Pos& p, const Object& o, const Dir& D) {
-		vector<Dir> allDirs = {Down, DR, Right, RU, Up, UL, Left, LD};
-		for (int i = 0; i < 8; ++i) {
-			Dir d = allDirs[i];
-			if (d != D and object_in(p+d, o)) return true;
-		}
+		int k = at(p);
+		for (int d = 0; d < DirSize; ++d) if (d != D and test(objects[o], k+offset[d])) return true;
 		return false;
 	}
+	//Returns one of the orders of {0, 1, 2, 3} at random (to shuffle Dirs)
+	//It's a xorshift seeded each round from the generator of the game, so games are still
+	//reproducible but it doesn't allocate a vector each time like random_permutation
+	inline const int* random_order() {
+		return random_order(seed);
+	}
+
+	//Same but with the generator seed
+	inline const int* random_order(unsigned int& seed) {
+		return orders[xorshift(seed) % 24];
+	}
+
+	inline unsigned int xorshift(unsigned int& seed) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		return seed;
+	}
+
+	//Marks id in S for this round
+	void mark(vector<int>& S, int id) {
+		if (id >= int(S.size())) S.resize(id+1, 0);
+		S[id] = round_stamp;
+	}
+
+	//Returns true if id has already decided his move this round
+	inline bool moved(int id) {
+		return id < int(units_moved.size()) and units_moved[id] == round_stamp;
+	}
+
+	//Returns true if an Ally can step in p with priority without bumping into another one: nobody
+	//else is going there and, if there's an Ally, he leaves before (attacks are always free)
+	bool free_cell(const Pos& p, int priority) {
+		if (fresh) return true;
+		int k = at(p);
+		if (claimed[k] == round_stamp) return false;
+		if (board[k] != Ally) return true;
+		return leaving[k] == round_stamp and leaving_priority[k] <= priority;
+	}
+
+	inline bool can_go(const Pos& p, int priority) {
+		return can_move(p) and free_cell(p, priority);
+	}
+
+	//Puts the move of id in priority_movements and reserves the cell he goes to (see free_cell)
+	//Attacking is not moving, so only the other moves leave a cell
+	void push_move(int priority, int id, Dir d) {
+		priority_movements[priority].push_back(make_pair(id, d));
+		if (d == UL) return;	//Not moving at all
+		int k = unit_k[id];
+		Object o = board[k+offset[d]];
+		if (o == Walker or o == Enemy or o == Corpse) return;
+		claimed[k+offset[d]] = round_stamp;
+		leaving[k] = round_stamp;
+		leaving_priority[k] = priority;
+	}
+
 	//id  is the id of an Alive unit
 	//Return true  if id hasn't benn beaten
 	inline bool healthy(int id) {
-		return unit(id).rounds_for_zombie == -1;
+		return unit_zombie[id] == -1;
+	}
+
+	inline Pos unit_pos(int id) const {
+		return pos_of(unit_k[id]);
 	}
 
 	// Returns true if it's secure for id not to move (not Walkers near or he is going to turn
 	// into a Walker)
 	bool secure(int id) {
-		return not healthy(id) or not object_adjacent(unit(id).pos, Walker);
+		return not healthy(id) or not test(adjacent[Walker], unit_k[id]);
 	}
 	
 	//Returns true if it's worth the wait
@@ -136,28 +554,18 @@ struct PLAYER_NAME : public Player {
 	//	There's a corpse near and he can kill him AGAIN when it turns into a walker
 	bool worth_the_wait(int id, const Pos& p) {
 		if (healthy(id)) return true; //I'm not  gonna turn into a zombie
-		int life_time = unit(id).rounds_for_zombie;
-		Cell c = cell(p);
-		Unit u = unit(c.id);
-		if (u.type == Dead) return life_time < u.rounds_for_zombie;
+		int life_time = unit_zombie[id];
+		int u = unit_in[at(p)];
+		if (u != -1 and kind[u] == Corpse) return life_time < unit_zombie[u];
 		return false;
 	}
 
 	//Returns true if id is can recorre distance before turning into a Walker
 	inline bool worth_the_wait(int id, int distance) {
-		int lifetime = unit(id).rounds_for_zombie;
+		int lifetime = unit_zombie[id];
 		return lifetime == -1 or distance < lifetime;
 	}
 	
-	//Returns true if there's a corridor in p
-	//Used when there's a unit chasing food
-	//If it's a corridor I just need one unit to go
-	bool corridor(const Pos& p) {
-		int n = 0;
-		for (int i = 0; i < 4; ++i) if (can_move(p+Dirs[i])) ++n;
-		return n == 2;
-	}
-	
 	//Returns the inverse Dir to d: {Up -> Down}
 	Dir inverse(const Dir& d) {
 		if (d == Up) return Down;
@@ -167,436 +575,2243 @@ struct PLAYER_NAME : public Player {
 	}
 	
 	//Returns the probability I have to win in an encounter against enemy
-	float win_rate(int enemy) {
-		int my_strength = strength(me());
-		int	his_strength = strength(enemy); 
-		if (my_strength == 0 and his_strength == 0) return 0.5;
-		return float (my_strength)/(my_strength+his_strength);
+	inline float win_rate(int enemy) {
+		return win_rates[enemy];
+	}
+
+	//Returns the offsets of all the cells at Manhattan distance r (r > 0)
+	const vector<Probe>& ring(int r) {
+		while (int(rings.size()) <= r) {
+			int n = rings.size();
+			rings.push_back(vector<Probe>());
+			for (int i = -n; i <= n and n > 0; ++i) {
+				int j = n - abs(i);
+				rings[n].push_back(Probe {i, j, i*stride + j});
+				if (j != 0) rings[n].push_back(Probe {i, -j, i*stride - j});
+		}	}
+		return rings[r];
+	}
+
+	//Returns the Manhattan distance from p to the nearest o (Walls don't matter), -1 if there's
+	//none at max_dist or less
+	int object_in_diamond(int max_dist, const Pos& p, const Object& o) {
+		const bitboard& b = objects[o];
+		int k = at(p);
+		for (int r = 1; r <= max_dist; ++r)
+			for (const Probe& x : ring(r)) {
+				int i = p.i + x.i, j = p.j + x.j;
+				if (i >= 0 and j >= 0 and i < board_rows() and j < board_cols() and test(b, k + x.k)) return r;
+			}
+		return -1;
 	}
 
 	//Returns the distance to the first o element starting from p with a max distance of max_dist
-	int object_at_distance(int max_dist, Pos& P, const Object& o) {
-		Pos p = P;
-		priority_queue<pair<int, Pos>, vector<pair<int, Pos> >, greater<pair<int, Pos> > > Q;
-		Q.push(make_pair(0, P));
-		while (not Q.empty()) {
-			int dist = Q.top().first;
-			P = Q.top().second; Q.pop();
-			if (dist >= max_dist) return -1;
-			if (object_crossed(p, o)) return dist+1;
-			if (can_move(p+Right)) Q.push(make_pair(dist+1, p+Right));
-			if (can_move(p+Left)) Q.push(make_pair(dist+1, p+Left));
-			if (can_move(p+Down)) Q.push(make_pair(dist+1, p+Down));
-			if (can_move(p+Up)) Q.push(make_pair(dist+1, p+Up));
-		}
-		P = p;
+	//(-1 if there's none). If walls, the path can't cross Walls (the o itself can be anything)
+	int object_at_distance(int max_dist, const Pos& p, const Object& o, bool walls = true) {
+		int first = object_in_diamond(max_dist, p, o);	//Walls can only make it further
+		if (first == -1 or not walls) return first;
+
+		if (reached.size() != board.size()) reached.assign(board.size(), 0);
+		++reach_stamp;
+		frontier.clear();
+		frontier.push_back(at(p));
+		reached[at(p)] = reach_stamp;
+		for (int dist = 0; dist < max_dist and not frontier.empty(); ++dist) {
+			next_frontier.clear();
+			for (int k : frontier)
+				for (int i = 0; i < 4; ++i) {
+					int aux = k + offset[Dirs[i]];
+					if (test(objects[o], aux)) return dist+1;
+					if (reached[aux] != reach_stamp and not test(objects[Wall], aux)) {
+						reached[aux] = reach_stamp;
+						next_frontier.push_back(aux);
+				}	}
+			swap(frontier, next_frontier);
+		}
 		return -1;
 	}
 	
 	//Returns the minimum distance to o from P in a max distance dist
-	int distance(int dist, Pos& P, const Object& o) {
+	int distance(int dist, const Pos& P, const Object& o) {
 		return object_at_distance(dist, P, o);
 	}
 
-	//Put in Q the pairs <distance, id> of each element in M
-	//The nature of Q orders automatically the values depending on their distance
-	void order_by_distance(searchers_list& Q, const map<int, Movement>& M) {
-		for (auto it = M.begin(); it != M.end(); ++it) {
-			int id = it->first; int distance = it->second.distance;
-			Q.push(make_pair(distance, id));
+	//Forecasts where the Walkers may go (and bite) in the next THREAT_ROUNDS rounds
+	//Walkers go to the nearest alive unit, so one BFS from all of them tells the way of every
+	//Walker, then they follow it (all the ways if there are ties)
+	//Walkers farther than THREAT_ROUNDS+1 from everybody can't bite anyone in time and are ignored
+	void write_threats() {
+		if (prey.size() != board.size()) {
+			prey.resize(board.size());
+			prey_stamp.assign(board.size(), 0);
+			threat.resize(board.size());
+			threat_stamp.assign(board.size(), 0);
+		}
+		vector<int>& q = threat_queue;
+		q.clear();
+		for (Object o : {Ally, Enemy})
+			for (int i = 0; i < int(layers[o].size()); ++i)
+				for (word w = layers[o][i]; w; w &= w-1) {
+					int k = (i << 6) + __builtin_ctzll(w);
+					prey_stamp[k] = round_stamp;
+					prey[k] = 0;
+					q.push_back(k);
+		}
+		for (size_t h = 0; h < q.size(); ++h) {
+			int k = q[h];
+			if (prey[k] > THREAT_ROUNDS) continue;
+			for (int i = 0; i < 4; ++i) {
+				int aux = k + offset[Dirs[i]];
+				if (prey_stamp[aux] != round_stamp and not test(layers[Wall], aux)) {
+					prey_stamp[aux] = round_stamp;
+					prey[aux] = prey[k] + 1;
+					q.push_back(aux);
+		}	}	}
+
+		q.clear();
+		for (const Pos& p : walker_pos) {
+			int k = at(p);
+			if (prey_stamp[k] == round_stamp and threat_stamp[k] != round_stamp) {
+				threat_stamp[k] = round_stamp;
+				threat[k] = 0;
+				q.push_back(k);
+		}	}
+		for (size_t h = 0; h < q.size(); ++h) {
+			int k = q[h];
+			int t = threat[k] + 1;
+			if (t > THREAT_ROUNDS) continue;
+			for (int i = 0; i < 4; ++i) {
+				int aux = k + offset[Dirs[i]];
+				//Stepping on a unit is biting it
+				if (prey_stamp[aux] == round_stamp and prey[aux] == prey[k]-1 and threat_stamp[aux] != round_stamp) {
+					threat_stamp[aux] = round_stamp;
+					threat[aux] = t;
+					q.push_back(aux);
+	}	}	}	}
+
+	//Returns true if a Walker may bite k within rounds rounds
+	inline bool threatened(int k, int rounds) const {
+		return threat_stamp[k] == round_stamp and threat[k] > 0 and threat[k] <= rounds;
+	}
+
+	//Writes in territory the distance to the nearest Square from the cells next to my units (the
+	//only ones go_to_square looks at)
+	//Done with one BFS starting from all the Squares, a whole level at a time: the next level is
+	//the cells around the current one that are not Walls nor reached yet, found word by word. It
+	//stops as soon as all the cells wanted are reached
+	void write_territory(int max_distance) {
+		territory_limit = max_distance;
+		if (reference) return;	//The original go_to searches on its own
+		if (mazy) return write_junction_territory(max_distance);
+		territory.assign(board.size(), -1);
+		int n = layers[Wall].size();
+		spread(wanted, layers[Ally], false);
+		front_bits = reached_bits = objects[Square];
+		int left = 0;
+		for (int i = 0; i < n; ++i) {
+			wanted[i] &= ~objects[Wall][i];	//They are never reached
+			left += __builtin_popcountll(wanted[i]);
+		}
+		left -= write_level(front_bits, 0);
+		for (int D = 1; D <= max_distance and left > 0; ++D) {
+			next_bits.assign(n, 0);
+			for (int i = 0; i < 4; ++i) or_shifted(next_bits, front_bits, offset[Dirs[i]]);
+			word any = 0;
+			for (int i = 0; i < n; ++i) {
+				next_bits[i] &= ~objects[Wall][i] & ~reached_bits[i];
+				reached_bits[i] |= next_bits[i];
+				any |= next_bits[i];
+			}
+			if (not any) break;
+			left -= write_level(next_bits, D);
+			swap(front_bits, next_bits);
 	}	}
 
-	//"Moves" (put id in priority_movement) to the nearest object in O
-	void go_to(int id, const vector<Object>& O) {
-		if (units_moved.find(id) != units_moved.end()) return;
-		
-		queue<pair<Pos, Movement>> Q;
-		vector<vector<bool> > visited(board_rows(), vector<bool>(board_cols(), false));
-		
-		Pos p = unit(id).pos;
-		visited[p.i][p.j] = true;
-		vector<int> v = random_permutation(4);
-		for (int i = 0; i < 4; ++i) {
-			Dir D = Dirs[v[i]]; Pos aux = p+D;
-			if (can_move(aux)) {
-				if (object_in(aux, O)) {
-					units_moved.insert(id);
-					priority_movements.push(make_pair(SECOND, make_pair(id, D)));
-					return;
+	//Writes distance in territory for the cells of level that are wanted, returns how many
+	int write_level(const bitboard& level, int distance) {
+		int found = 0;
+		for (int i = 0; i < int(level.size()); ++i) {
+			PROFILE_TALLY(territory_tally, nodes);
+			for (word w = level[i] & wanted[i]; w; w &= w-1) {
+				territory[(i << 6) + __builtin_ctzll(w)] = distance;
+				++found;
+		}	}
+		return found;
+	}
+
+	//Same on maze-like boards, but only for the junctions. The corridors are jumped at once and
+	//the distance of their cells is found when it's asked by territory_at
+	void write_junction_territory(int max_distance) {
+		junction_distance.assign(junctions.size(), -1);
+		if (junction_buckets.size() < size_t(max_distance+1)) junction_buckets.resize(max_distance+1);
+		for (int j = 0; j < int(junctions.size()); ++j)
+			if (test(objects[Square], junctions[j])) reach_junction(j, 0, max_distance);
+		//The nearest Square inside each corridor from both of its ends
+		for (const Chain& c : chains) {
+			for (int i = 0; i < c.length; ++i) {
+				int k = chain_cells[c.first+i];
+				if (test(objects[Square], k)) {
+					reach_junction(c.a, i+1, max_distance);
+					break;
 				}
-				if (not object_adjacent(aux, Walker)) Q.push(make_pair(aux, Movement {1, D}));
-				visited[aux.i][aux.j] = true;
+				if (test(objects[Wall], k)) break;
+			}
+			for (int i = c.length-1; i >= 0; --i) {
+				int k = chain_cells[c.first+i];
+				if (test(objects[Square], k)) {
+					reach_junction(c.b, c.length-i, max_distance);
+					break;
+				}
+				if (test(objects[Wall], k)) break;
 		}	}
+		for (int D = 0; D <= max_distance; ++D) {
+			for (size_t q = 0; q < junction_buckets[D].size(); ++q) {
+				PROFILE_TALLY(territory_tally, nodes);
+				int j = junction_buckets[D][q];
+				if (junction_distance[j] != D) continue;	//Reached again nearer
+				for (int c : chains_of[j]) {
+					const Chain& C = chains[c];
+					bool open = true;
+					for (int i = 0; i < C.length and open; ++i) open = not test(objects[Wall], chain_cells[C.first+i]);
+					if (open) reach_junction(C.a == j ? C.b : C.a, D + C.length + 1, max_distance);
+			}	}
+			junction_buckets[D].clear();
+	}	}
 
-		while (not Q.empty()) {
-			p = Q.front().first;
-			int distance = Q.front().second.distance + 1;
-			Dir D = Q.front().second.dir;	Q.pop();
-			v = random_permutation(4);
-			for (int i = 0; i < 4; ++i) {
-				Dir d = Dirs[v[i]]; Pos aux = p+d;
-				
-				if (can_move(aux) and not visited[aux.i][aux.j] and distance <= DISTANCE) {
-					if (object_in(aux, O)) {
-						if ( not object_in(aux, {Enemy, Corpse})
-								or (object_in(aux, Enemy) and win_rate(unit(cell(aux).id).player) > 0.5)
-								or (object_in(aux, Corpse) and distance < 5)) {
-						units_moved.insert(id);
-						priority_movements.push(make_pair(SECOND, make_pair(id, D)));
-						return;
-				}	}
-					Q.push(make_pair(aux, Movement{distance, D}));
-					visited[aux.i][aux.j] = true;
-	}	}	}	}
-	
-	//Finds the nearest units
-	void bfs_find_units(const Pos& P, map<int, Movement>& M) {
-		if (object_in(P, Wall)) return;
-		int interest = 0;
-		if (board[P.i][P.j] == Food) interest = 0;
-		if (board[P.i][P.j] == Walker) interest = 8;
-		if (board[P.i][P.j] == Enemy) interest = 4;
-		if (board[P.i][P.j] == Corpse) interest = 10;
-		queue<pair<Pos, int>> Q;
-		vector<vector<bool> > visited(board_rows(), vector<bool>(board_cols(), false));
-		int units_found = 0; //The # of units found during this call
+	void reach_junction(int j, int distance, int max_distance) {
+		if (distance > max_distance or (distance > 0 and test(objects[Wall], junctions[j]))) return;
+		if (junction_distance[j] != -1 and junction_distance[j] <= distance) return;
+		junction_distance[j] = distance;
+		junction_buckets[distance].push_back(j);
+		PROFILE_TALLY(territory_tally, pushes);
+	}
+
+	//Distance from k to the nearest Square (-1 if too far)
+	//A cell in a corridor goes to the nearest Square in it or to one of its ends
+	int territory_at(int k) {
+		if (not mazy) return territory[k];
+		if (test(objects[Square], k)) return 0;
+		if (test(objects[Wall], k)) return -1;
+		if (junction_of[k] != -1) return junction_distance[junction_of[k]];
+		const Chain& c = chains[chain_of[k]];
+		int i = chain_at[k];
+		int best = -1;
+		for (int z = i-1; ; --z) {
+			if (z == 0) {
+				if (junction_distance[c.a] != -1) best = junction_distance[c.a] + i;
+				break;
+			}
+			int aux = chain_cells[c.first+z-1];
+			if (test(objects[Square], aux)) {
+				best = i-z;
+				break;
+			}
+			if (test(objects[Wall], aux)) break;
+		}
+		for (int z = i+1; ; ++z) {
+			int distance = -1;
+			if (z == c.length+1) {
+				if (junction_distance[c.b] != -1) distance = junction_distance[c.b] + z-i;
+			}
+			else {
+				int aux = chain_cells[c.first+z-1];
+				if (test(objects[Square], aux)) distance = z-i;
+				else if (not test(objects[Wall], aux)) continue;
+			}
+			if (distance != -1 and (best == -1 or distance < best)) best = distance;
+			break;
+		}
+		return best > territory_limit ? -1 : best;
+	}
+
+	//"Moves" (put id in priority_movement) to the nearest Square following territory
+	//The first step never goes next to a Walker and avoids where they will be, ties are broken at
+	//random
+	void go_to_square(int id) {
+		if (moved(id)) return;
+#ifdef VERIFY
+		if (reference) return original_go_to(id);
+#endif
 		
-		vector<int> v = random_permutation(4);
+		Pos p = unit_pos(id);
+		int k = at(p);
+		int best = -1;
+		Dir D = Up;
+		const int* v = random_order();
 		for (int i = 0; i < 4; ++i) {
-			Dir d = Dirs[v[i]];
-			if (object_in(P+d, Ally) and not object_adjacent(P, Walker)) {
-				int id = cell(P+d).id;
-				if (units_moved.find(id) == units_moved.end()) {
-					Movement m = {1, inverse(d), P};
-					if (M.find(id) == M.end()) M.insert(make_pair(id, m));
-					else M[id] = m;
-					//Not gonna follow this path if it's a corridor (waste of time)
-					if (not corridor(P+d)) Q.push(make_pair(P+d, 1));
-					
-					++units_found; if (units_found > SEARCHERS) return;
-			}	}
-			else if (pos_ok(P+d) and not is_wall(P+d)) Q.push(make_pair(P+d, 1));
-			if (pos_ok(P+d)) visited[(P+d).i][(P+d).j] = true;
+			Dir d = Dirs[v[i]]; Pos aux = p+d;
+			if (not can_go(aux, SECOND)) continue;
+			int distance = territory_at(k+offset[d]);
+			if (distance > 0 and threatened(k+offset[d], 2)) distance += THREAT_ROUNDS;
+			if (distance == 0) {
+				best = 0; D = d;
+				break;
+			}
+			if (distance != -1 and (best == -1 or distance < best) and not object_adjacent(aux, Walker)) {
+				best = distance; D = d;
+		}	}
+		if (best != -1) {
+			mark(units_moved, id);
+			TRACE_AIM(id, p+D, best+1);
+			VERIFY_NOTE(id, Expanding, best+1);
+			push_move(SECOND, id, D);
+	}	}
+	
+	//Returns the interest of chasing what there is in p (less is better)
+	int interest(const Pos& p) {
+		Object o = board[at(p)];
+		if (o == Walker) return WALKER_INTEREST;
+		if (o == Enemy) return ENEMY_INTEREST;
+		if (o == Corpse) return CORPSE_INTEREST;
+		return 0;
+	}
+
+	//Keeps in S the best object found for the unit id
+	//On ties it's the first object of interest_pos, like searching from each object in order, but
+	//the last one of the objects next to him (they just overwrite the others)
+	void found_unit(Search& S, int id, int distance, Dir d, int src) {
+		if (S.retrying and S.found_in[id] != S.pass) {
+			S.found_in[id] = S.pass;
+			--S.unfound;
+		}
+		if (id >= int(S.searcher_of.size())) {
+			S.searcher_of.resize(id+1);
+			S.searcher_stamp.resize(id+1, 0);
+		}
+		if (S.searcher_stamp[id] != S.stamp) {
+			S.searcher_stamp[id] = S.stamp;
+			S.searcher_of[id] = S.searchers.size();
+			S.searchers.push_back(Searcher {distance, id, d, src});
+			return;
 		}
-		visited[P.i][P.j] = true;
+		Searcher& s = S.searchers[S.searcher_of[id]];
+		if (s.distance > distance or (s.distance == distance and (distance == 1 ? src > s.src : src < s.src)))
+			s = Searcher {distance, id, d, src};
+	}
 
-		
-		while (not Q.empty()) {
-			Pos p = Q.front().first; int distance = Q.front().second + 1; Q.pop();
-			v = random_permutation(4);
-			for (int z = 0; z < 4; ++z) {
-				Dir d = Dirs[v[z]]; 
-				Pos aux = p+d;
-				int i = aux.i; int j = aux.j;
-				if (distance <= DISTANCE and can_move(aux) and not visited[i][j]) {
-					visited[i][j] = true;
-					int id = cell(aux).id;
-					if (object_in(aux, Ally) and not object_adjacent(p, Walker)) {
-						if (units_moved.find(id) == units_moved.end()) {
-							int D = distance; if (healthy(id)) D += interest;
-							Movement m = {D, inverse(d), P};
-							if (M.find(id) == M.end()) M.insert(make_pair(id, m));
-							else if (M[id].distance > D) M[id] = m;
-
-							//Not gonna follow this path if it's a corridor (waste of time)
-							if (not corridor(aux)) Q.push(make_pair(aux, distance));
-							
-							++units_found; if (units_found > SEARCHERS) return;
-					}	}
-					else Q.push(make_pair(aux, distance));
-	} } } }
+	//The object of l finds the unit in aux, one step further than l, if he hasn't moved and it
+	//hasn't lost him. Returns true if it has found more than SEARCHERS units
+	bool find(Search& S, int aux, const Label& l, Dir d, bool weighted) {
+		int id = unit_in[aux];
+		int distance = l.distance + 1;
+		if (l.distance > 0 and not moved(id) and not lost(S, id, l.src, distance)) {
+			int dist = distance;
+			if (healthy(id)) dist += interest(interest_pos[l.src]);
+			if (healthy(id) == weighted and kept(S, id)) found_unit(S, id, dist, inverse(d), l.src);
+			if (++S.units_found[l.src] == SEARCHERS+1 and S.checking) S.reach[l.src] = distance;
+		}
+		return S.units_found[l.src] > SEARCHERS;
+	}
+
+	//If the current pass of S keeps what it finds of id: the first one keeps all the units, a
+	//retry only the ones it retries and a check none
+	inline bool kept(const Search& S, int id) const {
+		return not S.checking and (not S.retrying or S.wanted[id] == S.pass);
+	}
+
+	//The BFS of an object loses a unit if it reaches him first from a cell next to a Walker: it
+	//doesn't find him later from farther. Every object that loses him is kept
+	void lose_unit(Search& S, int id, int src, int steps) {
+		if (id >= int(S.lost_head.size())) {
+			S.lost_head.resize(id+1);
+			S.lost_stamp.resize(id+1, 0);
+		}
+		if (S.lost_stamp[id] != S.pass) {
+			S.lost_stamp[id] = S.pass;
+			S.lost_head[id] = -1;
+			S.lost_ids.push_back(id);
+		}
+		for (int i = S.lost_head[id]; i != -1; i = S.losses[i].next) if (S.losses[i].src == src) return;
+		S.losses.push_back(Loss {src, steps, S.lost_head[id]});
+		S.lost_head[id] = S.losses.size()-1;
+	}
+
+	inline bool lost(const Search& S, int id, int src, int steps) const {
+		if (id >= int(S.lost_head.size()) or S.lost_stamp[id] != S.pass) return false;
+		for (int i = S.lost_head[id]; i != -1; i = S.losses[i].next)
+			if (S.losses[i].src == src) return S.losses[i].steps < steps;
+		return false;
+	}
+
+	//If k is next to the object src and it is next to a Walker (the units in k don't go for it)
+	bool kept_away(int src, int k) {
+		int o = at(interest_pos[src]);
+		for (int i = 0; i < 4; ++i) if (o + offset[Dirs[i]] == k) return object_adjacent(interest_pos[src], Walker);
+		return false;
+	}
+
+	//Finds the nearest units to all the interest_pos at once
+	//Every cell is labelled with its nearest object (adding the interest of the object), and each
+	//time a unit is found it is kept in S.searchers with the Dir to its object.
+	//The objects with the same interest (a class) share a label in each cell, as the nearest one
+	//is also the one with fewer steps. The other classes can still go on from the cell if they
+	//get there in fewer steps: the ones that labelled it first may not get as far in DISTANCE
+	//An object that loses a unit still labels the cells around him, so it can keep the farther
+	//objects that would find him (searching from each object alone) from getting to him. Those
+	//units are searched again without the objects that lost them, and without the ones that
+	//lose them then too, until no nearer object loses them (see retry_lost). So are the units
+	//found by an object that would have found more than SEARCHERS units before them, as the
+	//others are not counted when they are nearer to another object (see retry_far)
+	//If weighted is false only unhealthy units are kept and interests are ignored, otherwise only
+	//healthy units are kept
+	//It only reads the board, so several searches can run at the same time with different S
+	void bfs_find_units(Search& S, bool weighted) {
+		int n = interest_pos.size();
+		S.searchers.clear();
+		S.classes = 0;
+		S.class_of.resize(n);
+		for (int src = 0; src < n; ++src) {
+			int i = weighted ? interest(interest_pos[src]) : 0;
+			int c = 0;
+			while (c < S.classes and S.class_interest[c] != i) ++c;
+			if (c == S.classes) S.class_interest[S.classes++] = i;
+			S.class_of[src] = c;
+		}
+		if (S.label.size() != INTERESTS*board.size()) {
+			S.label.resize(INTERESTS*board.size());
+			S.labelled.assign(INTERESTS*board.size(), 0);
+		}
+		if (S.excluded.size() < size_t(n)) S.excluded.resize(n, 0);
+		if (S.retry_label.size() != INTERESTS*board.size()) {
+			S.retry_label.resize(INTERESTS*board.size());
+			S.retry_labelled.assign(INTERESTS*board.size(), 0);
+		}
+		if (S.wanted.size() < kind.size()) {
+			S.wanted.resize(kind.size(), 0);
+			S.found_in.resize(kind.size(), 0);
+		}
+		if (S.reach.size() < size_t(n)) {
+			S.reach.resize(n);
+			S.reach_stamp.resize(n, 0);
+		}
+		++S.stamp;
+		++S.pass;
+		S.retrying = false;
+		S.retry.clear();
+		search_pass(S, weighted, S.label, S.labelled, S.stamp, INT_MAX);
+		retry_lost(S, weighted);
+
+		S.retrying = true;
+		do {
+			while (not S.retry.empty()) {
+				//The units lost by the same objects as the first one are retried together
+				int pass = ++S.pass;
+				const vector<int>& losers = S.losers[S.retry[0]];
+				for (int src : losers) S.excluded[src] = pass;
+				S.group.clear();
+				int left = 0;
+				for (int id : S.retry) {
+					if (S.losers[id] != losers) S.retry[left++] = id;
+					else {
+						S.group.push_back(id);
+						S.wanted[id] = pass;
+				}	}
+				S.retry.resize(left);
+				//Nothing farther than what the group has found can be better
+				int limit = 0;
+				for (int id : S.group) {
+					if (id >= int(S.searcher_stamp.size()) or S.searcher_stamp[id] != S.stamp) limit = INT_MAX;
+					else limit = max(limit, S.searchers[S.searcher_of[id]].distance);
+				}
+				S.unfound = S.group.size();
+				S.low = S.high = unit_pos(S.group[0]);
+				for (int id : S.group) {
+					Pos p = unit_pos(id);
+					S.low = Pos(min(S.low.i, p.i - DISTANCE), min(S.low.j, p.j - DISTANCE));
+					S.high = Pos(max(S.high.i, p.i + DISTANCE), max(S.high.j, p.j + DISTANCE));
+				}
+				search_pass(S, weighted, S.retry_label, S.retry_labelled, pass, limit);
+				retry_lost(S, weighted);
+			}
+			retry_far(S, weighted);
+		} while (not S.retry.empty());
+		S.retrying = false;
+
+		//The units that were only found beyond the reach of their objects are not kept
+		int left = 0;
+		for (const Searcher& s : S.searchers) if (s.distance != INT_MAX) S.searchers[left++] = s;
+		S.searchers.resize(left);
+	}
+
+	//Adds to S.retry the units kept by the last pass of S that an object lost while being as near
+	//to them as the best object found (if any), with the objects that lost them to their losers
+	void retry_lost(Search& S, bool weighted) {
+		for (int id : S.lost_ids) {
+			if (moved(id) or healthy(id) != weighted or not kept(S, id)) continue;
+			int nearest = INT_MAX;
+			for (int i = S.lost_head[id]; i != -1; i = S.losses[i].next) {
+				const Loss& loss = S.losses[i];
+				nearest = min(nearest, loss.steps + (weighted ? interest(interest_pos[loss.src]) : 0));
+			}
+			if (id < int(S.searcher_stamp.size()) and S.searcher_stamp[id] == S.stamp
+					and S.searchers[S.searcher_of[id]].distance < nearest) continue;
+			for (int i = S.lost_head[id]; i != -1; i = S.losses[i].next) exclude(S, id, S.losses[i].src);
+			S.retry.push_back(id);
+	}	}
+
+	//Adds to S.retry the units whose object wouldn't get to them searching from it alone, as it
+	//would find more than SEARCHERS units before, with the object to their losers. They are
+	//forgotten until a retry finds them again
+	void retry_far(Search& S, bool weighted) {
+		for (Searcher& s : S.searchers) {
+			if (s.distance == INT_MAX) continue;
+			int steps = s.distance == 1 ? 1 : s.distance - (weighted ? S.class_interest[S.class_of[s.src]] : 0);
+			if (steps <= reach(S, weighted, s.src, steps)) continue;
+			s.distance = INT_MAX;
+			exclude(S, s.id, s.src);
+			S.retry.push_back(s.id);
+	}	}
+
+	//Steps at which the object src finds more than SEARCHERS units searching from it alone (any
+	//number from steps on if it can't be less). Only if there are that many units at steps or
+	//less (the Manhattan distance is the least they can be) it is searched alone, once a search
+	int reach(Search& S, bool weighted, int src, int steps) {
+		if (S.reach_stamp[src] == S.stamp) return S.reach[src];
+		Pos p = interest_pos[src];
+		int near = 0;
+		for (int id : my_units) {
+			if (moved(id)) continue;
+			Pos q = unit_pos(id);
+			if (abs(p.i-q.i) + abs(p.j-q.j) <= steps and ++near > SEARCHERS+1) break;
+		}
+		if (near <= SEARCHERS+1) return steps;
+		int pass = ++S.pass;
+		for (int o = 0; o < int(interest_pos.size()); ++o) if (o != src) S.excluded[o] = pass;
+		S.checking = true;
+		S.reach[src] = INT_MAX;
+		search_pass(S, weighted, S.retry_label, S.retry_labelled, pass, INT_MAX);
+		S.checking = false;
+		S.reach_stamp[src] = S.stamp;
+		return S.reach[src];
+	}
+
+	//Adds src to the objects id is retried without
+	void exclude(Search& S, int id, int src) {
+		if (id >= int(S.losers.size())) {
+			S.losers.resize(id+1);
+			S.retried.resize(id+1, 0);
+		}
+		vector<int>& losers = S.losers[id];
+		if (S.retried[id] != S.stamp) {
+			S.retried[id] = S.stamp;
+			losers.clear();
+		}
+		vector<int>::iterator it = lower_bound(losers.begin(), losers.end(), src);
+		if (it == losers.end() or *it != src) losers.insert(it, src);
+	}
+
+	//If an object that goes on from aux got there before the object src, which gets there in steps:
+	//in as many steps or fewer, and nearer (or as near and earlier in interest_pos)
+	bool covered(const Search& S, const vector<Label>& label, const vector<int>& labelled, int stamp, int aux,
+							 int src, int steps) {
+		int near = steps + S.class_interest[S.class_of[src]];
+		for (int c = 0; c < S.classes; ++c) {
+			int i = aux*S.classes + c;
+			if (labelled[i] != stamp or not label[i].open or label[i].distance > steps) continue;
+			if (S.units_found[label[i].src] > SEARCHERS) continue;	//It doesn't go on anymore
+			int other = label[i].distance + S.class_interest[c];
+			if (other < near or (other == near and label[i].src < src)) return true;
+		}
+		return false;
+	}
+
+	//If the current pass of S searches the cell k: a retry only the ones near enough to its units
+	//to be on the way of an object to them (no object goes farther than DISTANCE)
+	inline bool searched(const Search& S, int k) const {
+		if (not S.retrying or S.checking) return true;
+		Pos p = pos_of(k);
+		return p.i >= S.low.i and p.i <= S.high.i and p.j >= S.low.j and p.j <= S.high.j;
+	}
+
+	//# of cells next to k that are not Walls
+	inline int ways(int k) {
+		int n = 0;
+		for (int i = 0; i < 4; ++i) if (not test(objects[Wall], k + offset[Dirs[i]])) ++n;
+		return n;
+	}
+
+	//A pass of bfs_find_units from the objects not excluded, labelling the cells in label with
+	//stamp. The buckets from limit on are not expanded, nor the ones after all the units retried
+	//are found (the units are found and lost in order of distance, interest included)
+	void search_pass(Search& S, bool weighted, vector<Label>& label, vector<int>& labelled, int stamp, int limit) {
+		int n = interest_pos.size();
+		int max_interest = weighted ? max(WALKER_INTEREST, max(ENEMY_INTEREST, CORPSE_INTEREST)) : 0;
+		vector<vector<int> >& buckets = S.buckets;
+		vector<int>& units_found = S.units_found;
+		int C = S.classes;
+		units_found.assign(n, 0);
+		S.losses.clear();
+		S.lost_ids.clear();
+		if (buckets.size() < size_t(DISTANCE+max_interest+2)) buckets.resize(DISTANCE+max_interest+2);
+
+		//Units next to an object will always go for it
+		for (int src = 0; src < n; ++src) {
+			Pos P = interest_pos[src];
+			if (taken(src) or S.excluded[src] == S.pass or not searched(S, at(P)) or object_in(P, Wall)
+					or object_adjacent(P, Walker)) continue;
+			for (int i = 0; i < 4; ++i) {
+				Dir d = Dirs[i];
+				if (not object_in(P+d, Ally)) continue;
+				int id = unit_in[at(P+d)];
+				if (not moved(id)) {
+					if (healthy(id) == weighted and kept(S, id)) found_unit(S, id, 1, inverse(d), src);
+					if (++units_found[src] == SEARCHERS+1 and S.checking) S.reach[src] = 1;
+		}	}	}
+
+		//Objects start at their interest, so the nearest one labels each cell. Their own cells are
+		//labelled before, as only they can leave them to the cells next to an Enemy or a Walker
+		for (int src = 0; src < n; ++src) {
+			Pos P = interest_pos[src];
+			if (taken(src) or S.excluded[src] == S.pass or not searched(S, at(P)) or object_in(P, Wall)) continue;
+			int c = S.class_of[src];
+			int i = at(P)*C + c;
+			labelled[i] = stamp;
+			label[i] = Label {src, 0, Up, true};
+			buckets[S.class_interest[c]].push_back(at(P)*INTERESTS + c);
+		}
+
+		for (int D = 0; D < int(buckets.size()); ++D) {
+			if (D >= limit) {
+				buckets[D].clear();
+				continue;
+			}
+			for (size_t q = 0; q < buckets[D].size(); ++q) {
+				PROFILE_TALLY(S.tally, nodes);
+				int k = buckets[D][q] / INTERESTS;
+				int c = buckets[D][q] % INTERESTS;
+				Label l = label[k*C + c];
+				//It was labelled again farther after it was put here, or the object doesn't go on
+				if (l.distance + S.class_interest[c] != D or units_found[l.src] > SEARCHERS) continue;
+				int distance = l.distance + 1;
+				//Healthy units don't go where a Walker will be next round
+				bool walker_near = test(adjacent[Walker], k) or (weighted and threatened(k, 1));
+				const int* v = random_order(S.seed);
+				for (int z = 0; z < 4; ++z) {
+					Dir d = Dirs[v[z]];
+					int aux = k + offset[d];
+					int i = aux*C + c;
+					//Next to the object I don't care about the menaces, only about the Waste (and the border)
+					if (l.distance == 0 ? board[aux] == Wall : distance > DISTANCE or test(objects[Wall], aux)) continue;
+					if (not searched(S, aux)) continue;
+					//Each object gets once to each cell
+					if (labelled[i] == stamp and label[i].src == l.src) continue;
+					bool ally = test(objects[Ally], aux);
+					//Units are found from the cells without a Walker near. From the others the object
+					//goes through them like through an empty cell, and never finds them
+					if (ally and ((l.distance > 0 and walker_near) or kept_away(l.src, aux))) {
+						lose_unit(S, unit_in[aux], l.src, distance);
+						ally = false;
+					}
+					//Every object finds the units it gets to, even the ones nearer to another object
+					bool full = ally and find(S, aux, l, d, weighted);
+					//Not gonna follow this path if it's a corridor (waste of time)
+					bool open = not ally or (not moved(unit_in[aux]) and ways(aux) != 2);
+					//It labels the cell for its class unless an object that goes on from it is before (see
+					//covered). A cell as near to an earlier object of its class is its (it isn't expanded yet)
+					if ((open or labelled[i] != stamp) and not covered(S, label, labelled, stamp, aux, l.src, distance)) {
+						//If it is already in the bucket it's only taken
+						bool queued = labelled[i] == stamp and label[i].open and label[i].distance == distance;
+						labelled[i] = stamp;
+						label[i] = Label {l.src, distance, inverse(d), open};
+						PROFILE_TALLY(S.tally, pushes);
+						if (open and not queued) buckets[D+1].push_back(aux*INTERESTS + c);
+					}
+					if (full) break;
+			}	}
+			buckets[D].clear();
+			//A retry ends with the bucket where it finds the last of its units, the rest are farther
+			if (S.retrying and not S.checking and S.unfound == 0) limit = D+1;
+	}	}
 	
-	//Finds the nearest units to each food. 
-	//After calling bfs_find_units, M will store all the units with the DIR to their nearest food
-	//However it will only chase the food that is nearest
+	//Finds the nearest units to each object of interest_pos
+	//After calling bfs_find_units, searchers will store all the units with the DIR to their nearest
+	//object. However only the nearest unit will chase each object
 	void move_nearest_unit() {
-		map<int, Movement> M;
-		for (Pos p : interest_pos) bfs_find_units(p, M);
-
-		set<Pos> obj_assigned;
-		searchers_list Q; order_by_distance(Q, M);
-		while (not Q.empty()) { //Takes the unit with minimum distance to an object and it's the only
-			int id = Q.top().second; Q.pop();
-			Movement m = M[id];
-			if (obj_assigned.find(m.pos) == obj_assigned.end()) {
-			obj_assigned.insert(m.pos);
-			units_moved.insert(id);
-			priority_movements.push(make_pair(SECOND, make_pair(id, m.dir)));}
+#ifdef VERIFY
+		if (reference) return original_chase();
+#endif
+		if (assigned.size() < interest_pos.size()) assigned.resize(interest_pos.size(), 0);
+		++stamp;
+		if (not fresh) keep_chases();
+		//Only the units that don't keep their chase are searched
+		bool unhealthy = false, healthy_left = false;
+		for (int id : my_units) if (not moved(id)) {
+			if (healthy(id)) healthy_left = true;
+			else unhealthy = true;
+		}
+		searches[0].searchers.clear();
+		searches[1].searchers.clear();
+#ifdef THREADS
+		if (unhealthy) searcher.run([this] { bfs_find_units(searches[1], false); });
+#else
+		if (unhealthy) bfs_find_units(searches[1], false);
+#endif
+		if (healthy_left) bfs_find_units(searches[0], true);
+#ifdef THREADS
+		if (unhealthy) searcher.wait();
+#endif
+
+		//Each unit is only in one of the searches, and the order doesn't depend on who ended first
+		searchers = searches[0].searchers;
+		searchers.insert(searchers.end(), searches[1].searchers.begin(), searches[1].searchers.end());
+
+		sort(searchers.begin(), searchers.end(), [](const Searcher& a, const Searcher& b) {
+			return a.distance < b.distance or (a.distance == b.distance and a.id < b.id);
+		});
+		//Takes the unit with minimum distance to an object and it's the only one that chases it
+		for (const Searcher& s : searchers) {
+			if (taken(s.src)) continue;
+			//If another Ally is going there, the next one will chase the object
+			if (not free_cell(unit_pos(s.id)+s.dir, SECOND)) continue;
+			assigned[s.src] = stamp;
+			mark(units_moved, s.id);
+			TRACE_AIM(s.id, interest_pos[s.src], s.distance);
+			VERIFY_NOTE(s.id, Chasing, s.distance);
+			push_move(SECOND, s.id, s.dir);
+			remember_chase(s);
+	}	}
+
+	inline bool taken(int src) const {
+		return assigned[src] == stamp;
+	}
+
+	//Keeps the path of s to its object, from the labels of the search that found him
+	void remember_chase(const Searcher& s) {
+		if (s.id >= int(chases.size())) chases.resize(s.id+1);
+		Chase& c = chases[s.id];
+		const Search& S = searches[healthy(s.id) ? 0 : 1];
+		int target = at(interest_pos[s.src]);
+		int k = unit_k[s.id] + offset[s.dir];
+		c.round = -1;
+		c.path.clear();
+		c.path.push_back(unit_k[s.id]);
+		c.path.push_back(k);
+		int C = S.classes, cls = S.class_of[s.src];
+		while (k != target) {
+			int i = k*C + cls;
+			if (S.labelled[i] != S.stamp or S.label[i].src != s.src or int(c.path.size()) > DISTANCE+1) return;
+			k += offset[S.label[i].dir];
+			c.path.push_back(k);
+		}
+		c.round = round();
+		c.healthy = healthy(s.id);
+		c.target = board[target];
+		c.step = 0;
+	}
+
+	//Units keep chasing what they chased last round if it's still worth it: they did the step,
+	//the object is still there, no other Ally that hasn't moved is nearer to it, and the rest of
+	//the path can still be walked and is not longer than DISTANCE. Only the others are searched
+	//again
+	void keep_chases() {
+		for (int src = 0; src < int(interest_pos.size()); ++src) {
+			int k = at(interest_pos[src]);
+			interest_at[k] = src;
+			interest_stamp[k] = round_stamp;
+		}
+		for (int id : my_units) {
+			if (moved(id) or id >= int(chases.size()) or chases[id].round != round()-1) continue;
+			Chase& c = chases[id];
+			c.round = -1;
+			int last = c.path.size()-1;
+			if (c.step+2 > last or c.path[c.step+1] != unit_k[id] or c.healthy != healthy(id)) continue;
+			int target = c.path[last];
+			if (interest_stamp[target] != round_stamp or board[target] != c.target) continue;
+			int src = interest_at[target];
+			if (taken(src) or test(objects[Wall], target)) continue;
+			int left = last - (c.step+1);	//Steps from the unit to the object
+			if (left > DISTANCE or nearer_ally(id, target, left)) continue;
+			bool open = true;
+			for (int i = c.step+2; i < last and open; ++i) open = not test(objects[Wall], c.path[i]);
+			if (not open) continue;
+			int next = c.path[c.step+2];
+			if (c.healthy and (test(adjacent[Walker], next) or threatened(next, 1))) continue;
+			Dir d = Up;
+			for (int i = 0; i < 4; ++i) if (unit_k[id] + offset[Dirs[i]] == next) d = Dirs[i];
+			if (not free_cell(pos_of(next), SECOND)) continue;
+			++c.step;
+			c.round = round();
+			assigned[src] = stamp;
+			mark(units_moved, id);
+			TRACE_AIM(id, interest_pos[src], last - c.step);
+			push_move(SECOND, id, d);
 	}	}
 
+	//Returns true if an Ally that hasn't moved, other than id, is at less than distance steps
+	//from k (the Manhattan distance is the least it can be)
+	bool nearer_ally(int id, int k, int distance) {
+		Pos p = pos_of(k);
+		for (int other : my_units) {
+			if (other == id or moved(other)) continue;
+			Pos q = unit_pos(other);
+			if (abs(p.i-q.i) + abs(p.j-q.j) < distance) return true;
+		}
+		return false;
+	}
+
 	//looks if it's a menace id can directly attack and do it if its possible
 	void attack_nearest(int id) {
-		if (units_moved.find(id) != units_moved.end()) return;
+		if (moved(id)) return;
 		
-		Pos p = unit(id).pos;
-		vector<int> v = random_permutation(4);
+		Pos p = unit_pos(id);
+		const int* v = random_order();
 		//FIRST, I must attack first in order to get most rate of win
 		for (int i = 0; i < 4; ++i) {
 			Dir d = Dirs[v[i]];
 			if (object_in(p+d, Enemy)) {
-				priority_movements.push(make_pair(FIRST, make_pair(id, d)));
-				units_moved.insert(id);	return;
+				push_move(FIRST, id, d);
+				mark(units_moved, id);	return;
 		} }
 
 		
 		//MID PRIORTY, Walkers moves the last so i'm not gonna take it seriously
-		v = random_permutation(4);
+		v = random_order();
 		for (int i = 0; i < 4; ++i) {
 			Dir d = Dirs[v[i]];
 			if (object_in(p+d, Walker) 
 					and not (object_adjacent(p, Walker, d) and healthy(id))) {
-				priority_movements.push(make_pair(SECOND, make_pair(id, d)));
-				board[(p+d).i][(p+d).j] = Wall;
-				units_moved.insert(id);	return;
+				push_move(SECOND, id, d);
+				mark_wall(p+d);
+				mark(units_moved, id);	return;
 		} }
 
 		if (object_crossed(p, Corpse)) return; //If we are camping a corpse we only wanna attack if we are not moving at all
 		
-		v = random_permutation(4);
+		v = random_order();
 		for (int i = 0; i < 4; ++i) {
 			Dir d = Dirs[v[i]];
-			if (object_in(p+d+d, Enemy) and not is_wall(p+d) and not (healthy(id) and object_adjacent(p+d, Walker))) {
-				priority_movements.push(make_pair(LAST, make_pair(id, d)));
-				units_moved.insert(id);	return;
+			if (pos_ok(p+d) and not is_wall(p+d) and free_cell(p+d, LAST) and object_in(p+d+d, Enemy) and not (healthy(id) and object_adjacent(p+d, Walker))) {
+				push_move(LAST, id, d);
+				mark(units_moved, id);	return;
 		} }
 
 
 		//LAST, I'm gonna wait, if he moves to that position I can attack him directly
 		//Priorize position if it's Food in there (more probability Enemy will go there)
-		int r = random(0, 1);
+		int r = xorshift(seed) & 1;
 		if (object_in(p+DR, Enemy)) {
-			if (can_move(p+Down) and object_crossed(p+Down, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Down)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (can_move(p+Right) and (object_crossed(p+Right, Food))) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Right)));
-				last_moved.insert(id);
-				units_moved.insert(id); return;
-			}
-			else if (r == 0 and can_move(p+Right) and not object_adjacent(p+Right, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Right)));
-				last_moved.insert(id);
-				units_moved.insert(id); return;
-			}
-			else if (can_move(p+Down) and not object_adjacent(p+Down, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Down)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
+			if (can_go(p+Down, LAST) and object_crossed(p+Down, Food)) {
+				push_move(LAST, id, Down);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (can_go(p+Right, LAST) and (object_crossed(p+Right, Food))) {
+				push_move(LAST, id, Right);
+				mark(last_moved, id);
+				mark(units_moved, id); return;
+			}
+			else if (r == 0 and can_go(p+Right, LAST) and not object_adjacent(p+Right, Walker)) {
+				push_move(LAST, id, Right);
+				mark(last_moved, id);
+				mark(units_moved, id); return;
+			}
+			else if (can_go(p+Down, LAST) and not object_adjacent(p+Down, Walker)) {
+				push_move(LAST, id, Down);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
 		} }
 		if (object_in(p+RU, Enemy)) {
-			if (can_move(p+Up) and object_crossed(p+Up, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Up)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (can_move(p+Right) and object_crossed(p+Right, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Right)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (r == 0 and can_move(p+Up) and not object_adjacent(p+Up, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Up)));
-				last_moved.insert(id);
-				units_moved.insert(id); return;
-			}
-			else if (can_move(p+Right) and not object_adjacent(p+Right, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Right)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
+			if (can_go(p+Up, LAST) and object_crossed(p+Up, Food)) {
+				push_move(LAST, id, Up);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (can_go(p+Right, LAST) and object_crossed(p+Right, Food)) {
+				push_move(LAST, id, Right);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (r == 0 and can_go(p+Up, LAST) and not object_adjacent(p+Up, Walker)) {
+				push_move(LAST, id, Up);
+				mark(last_moved, id);
+				mark(units_moved, id); return;
+			}
+			else if (can_go(p+Right, LAST) and not object_adjacent(p+Right, Walker)) {
+				push_move(LAST, id, Right);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
 		} }
 		if (object_in(p+UL, Enemy)) {
-			if (can_move(p+Up) and object_crossed(p+Up, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Up)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (can_move(p+Left) and object_crossed(p+Left, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Left)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (r == 0 and can_move(p+Up) and not object_adjacent(p+Up, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Up)));
-				last_moved.insert(id);
-				units_moved.insert(id); return;
-			}
-			else if (can_move(p+Left) and not object_adjacent(p+Left, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Left)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
+			if (can_go(p+Up, LAST) and object_crossed(p+Up, Food)) {
+				push_move(LAST, id, Up);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (can_go(p+Left, LAST) and object_crossed(p+Left, Food)) {
+				push_move(LAST, id, Left);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (r == 0 and can_go(p+Up, LAST) and not object_adjacent(p+Up, Walker)) {
+				push_move(LAST, id, Up);
+				mark(last_moved, id);
+				mark(units_moved, id); return;
+			}
+			else if (can_go(p+Left, LAST) and not object_adjacent(p+Left, Walker)) {
+				push_move(LAST, id, Left);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
 		} }
 		if (object_in(p+LD, Enemy)) {
-			if (can_move(p+Down) and object_crossed(p+Down, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Down)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (can_move(p+Left) and object_crossed(p+Left, Food)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Left)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
-			}
-			else if (r == 0 and can_move(p+Left) and not object_adjacent(p+Left, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Left)));
-				last_moved.insert(id);
-				units_moved.insert(id); return;
-			}
-			else if (can_move(p+Down) and not object_adjacent(p+Down, Walker)) {
-				priority_movements.push(make_pair(LAST, make_pair(id, Down)));
-				last_moved.insert(id);
-				units_moved.insert(id);	return;
+			if (can_go(p+Down, LAST) and object_crossed(p+Down, Food)) {
+				push_move(LAST, id, Down);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (can_go(p+Left, LAST) and object_crossed(p+Left, Food)) {
+				push_move(LAST, id, Left);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
+			}
+			else if (r == 0 and can_go(p+Left, LAST) and not object_adjacent(p+Left, Walker)) {
+				push_move(LAST, id, Left);
+				mark(last_moved, id);
+				mark(units_moved, id); return;
+			}
+			else if (can_go(p+Down, LAST) and not object_adjacent(p+Down, Walker)) {
+				push_move(LAST, id, Down);
+				mark(last_moved, id);
+				mark(units_moved, id);	return;
 		} }
 		//I'm evaluating Enemies first because they gave more points and also they are intelligent
 		//Walkers only goes to neares Alives
 	}
 	
-	// id decides not to move if it will give him beneficts at future
-	void wait_if_worth(int id) {
-		if (units_moved.find(id) != units_moved.end()) return;
-		Pos p = unit(id).pos;
+	//Takes a picture of all the units for the simulator (only the first time it's needed each round)
+	void snapshot() {
+		if (sim_stamp == round_stamp) return;
+		sim_stamp = round_stamp;
+		bodies.clear();
+		occupant.assign(board.size(), -1);
+		for (int id : all_units) {
+			if (id >= int(body_of.size())) body_of.resize(id+1);
+			body_of[id] = bodies.size();
+			occupant[unit_k[id]] = bodies.size();
+			bodies.push_back(Body {unit_k[id], kind[id], unit_player[id], unit_zombie[id]});
+	}	}
 
-		//CASE 1: Wait Corpse to turn into a zombie
-		for (int i = 0; i < 4; ++i) {
-			Pos aux = p+Dirs[i];
-			if (object_in(aux, Corpse) and worth_the_wait(id, aux)) {
+	//Index in arena of the unit in k in the world being simulated, -1 if nobody
+	int who(int k) {
+		for (int i = int(overlay.size())-1; i >= 0; --i) if (overlay[i].first == k) return overlay[i].second;
+		return occupant[k];
+	}
+
+	void place(int b, int k) {
+		overlay.push_back(make_pair(arena[b].k, -1));
+		overlay.push_back(make_pair(k, b));
+		arena[b].k = k;
+	}
+
+	//a attacks b (an Ally an Enemy or the other way round), the loser will turn into a Walker
+	void fight(int a, int b) {
+		int ally = arena[a].type == Ally ? a : b, enemy = ally == a ? b : a;
+		bool ally_wins = xorshift(sim_seed) % 1000 < 1000*win_rate(arena[enemy].player);
+		int loser = ally_wins ? enemy : ally;
+		if (ally_wins and ally == hero) ++kills;
+		arena[loser].type = Corpse;
+		arena[loser].rounds_for_zombie = ZOMBIE_ROUNDS;
+	}
+
+	//b (an Ally) goes to d: moves, kills a Walker or attacks an Enemy
+	void sim_move(int b, int d) {
+		int k = arena[b].k + offset[d];
+		if (board[k] == Wall) return;
+		int o = who(k);
+		if (o == -1) place(b, k);
+		else if (arena[o].type == Walker) {
+			arena[o].type = Nothing;
+			overlay.push_back(make_pair(k, -1));
+			++kills;
+		}
+		else if (arena[o].type == Enemy) fight(b, o);
+	}
+
+	//Simulates a round of the world in which b goes to d (UL to wait)
+	//Later rounds (d == -1) b only kills the Walkers next to him, Enemies attack the Allies next to
+	//them and Walkers go to the nearest alive unit and bite it if they can
+	void sim_round(int b, int d) {
+		if (arena[b].type == Ally and d != UL) {
+			if (d != -1) sim_move(b, d);
+			else for (int i = 0; i < 4 and d == -1; ++i) {
+				int o = who(arena[b].k + offset[Dirs[i]]);
+				if (o != -1 and arena[o].type == Walker) sim_move(b, d = Dirs[i]);
+		}	}
+		for (int e : nearby) if (arena[e].type == Enemy)
+			for (int i = 0; i < 4; ++i) {
+				int o = who(arena[e].k + offset[Dirs[i]]);
+				if (o != -1 and arena[o].type == Ally) {
+					fight(e, o);
+					break;
+			}	}
+		for (int w : nearby) if (arena[w].type == Walker) {
+			Pos p = pos_of(arena[w].k);
+			int target = -1, best = 0;
+			for (int a : nearby) if (arena[a].type == Ally or arena[a].type == Enemy) {
+				Pos q = pos_of(arena[a].k);
+				int dist = abs(p.i-q.i) + abs(p.j-q.j);
+				if (target == -1 or dist < best) { target = a; best = dist; }
+			}
+			if (target == -1) break;
+			if (best > 1) {
+				Pos q = pos_of(arena[target].k);
+				Dir D = q.i > p.i ? Down : q.i < p.i ? Up : q.j > p.j ? Right : Left;
+				int k = arena[w].k + offset[D];
+				if (board[k] != Wall and who(k) == -1) {
+					place(w, k);
+					--best;
+			}	}
+			if (best == 1 and arena[target].rounds_for_zombie == -1) arena[target].rounds_for_zombie = ZOMBIE_ROUNDS;
+		}
+		for (int u : nearby)
+			if (arena[u].rounds_for_zombie > 0 and --arena[u].rounds_for_zombie == 0 and arena[u].type != Nothing) {
+				arena[u].type = Walker;
+				arena[u].rounds_for_zombie = -1;
+	}	}
+
+	//Writes in nearby the units that can meet b in the rollouts: the Walkers that can reach him and
+	//the ones they may go for instead, so nobody farther than 2*(HORIZON+2) is simulated
+	void gather(int b) {
+		nearby.clear();
+		Pos p = pos_of(bodies[b].k);
+		for (int u = 0; u < int(bodies.size()); ++u) {
+			Pos q = pos_of(bodies[u].k);
+			if (abs(p.i-q.i) + abs(p.j-q.j) <= 2*(HORIZON+2)) nearby.push_back(u);
+	}	}
+
+	//Simulates HORIZON rounds in which id goes first to d (UL to wait) and returns how good
+	//it was for him
+	int rollout(int id, int d) {
+		int b = body_of[id];
+		arena = bodies;	//Only the units are copied, the cells are shared with the snapshot
+		overlay.clear();
+		hero = b;
+		kills = 0;
+		--ROLLOUTS_LEFT;
+		for (int t = 0; t < HORIZON; ++t) sim_round(b, t == 0 ? d : -1);
+		int score = 4*kills;
+		if (arena[b].type == Ally) score += arena[b].rounds_for_zombie == -1 ? 10 : 4;
+		else score -= 10;
+		return score;
+	}
+
+	//Returns true unless the simulations say that id would be clearly better moving than waiting
+	//When there's no time or simulations left we trust the heuristics
+	bool worth_waiting(int id) {
+		if (not in_time(0.3) or ROLLOUTS_LEFT < 5*ROLLOUTS) return true;
+		snapshot();
+		gather(body_of[id]);
+		Pos p = unit_pos(id);
+		int wait = 0;
+		for (int r = 0; r < ROLLOUTS; ++r) wait += rollout(id, UL);
+		for (int i = 0; i < 4; ++i) {
+			if (is_wall(p+Dirs[i])) continue;
+			int go = 0;
+			for (int r = 0; r < ROLLOUTS; ++r) go += rollout(id, Dirs[i]);
+			if (go > wait + 2*ROLLOUTS) return false;
+		}
+		return true;
+	}
+
+	// id decides not to move if it will give him beneficts at future
+	void wait_if_worth(int id) {
+		if (moved(id)) return;
+		Pos p = unit_pos(id);
+
+		//CASE 1: Wait Corpse to turn into a zombie
+		for (int i = 0; i < 4; ++i) {
+			Pos aux = p+Dirs[i];
+			if (object_in(aux, Corpse) and worth_the_wait(id, aux)) {
 				//if a zombie can attack me and I'm not beaten it's better to run to an adjacent position to
 				//Corpse that is also secure, if there's not the unit is sacrificed
 				if (object_adjacent(p, Walker) and healthy(id)) {
 					for (int j = 0; j < 4; ++j) {
-						if (j != i and not object_adjacent(p+Dirs[j], Walker) and object_adjacent(p+Dirs[j], Corpse)) {
-							priority_movements.push(make_pair(SECOND, make_pair(id, Dirs[j])));
-							units_moved.insert(id);
+						if (j != i and pos_ok(p+Dirs[j]) and free_cell(p+Dirs[j], SECOND) and not object_adjacent(p+Dirs[j], Walker) and object_adjacent(p+Dirs[j], Corpse)) {
+							push_move(SECOND, id, Dirs[j]);
+							mark(units_moved, id);
 							return;
 				}	}	}
-				else units_moved.insert(id);
-				board[aux.i][aux.j] = Wall;
+				else if (worth_waiting(id)) mark(units_moved, id);
+				mark_wall(aux);
 		}	}
 		//CASE 2: Distance 2 to Walker, {There's only one or I have no time} <- not implemented
 		//Waits if finds 
 		/*for (int i = 0; i < 4; ++i) {
 			if (object_in(p+Dirs[i]+Dirs[i], Walker) and not (healthy(id) and object_adjacent(p, Walker))) {
-				units_moved.insert(id);
+				mark(units_moved, id);
 		} }*/
 		//CASE 3: Enemy at distance 3
-		if (distance(3, p, Enemy) == 3 and secure(id) and not object_crossed(p, Food)) {
-			units_moved.insert(id);
-			board[p.i][p.j] = Wall;
+		if (distance(3, p, Enemy) == 3 and secure(id) and not (healthy(id) and threatened(at(p), 2))
+				and not object_crossed(p, Food) and worth_waiting(id)) {
+			mark(units_moved, id);
+			mark_wall(p);
 		}
-		if (units_moved.find(id) != units_moved.end())
-			priority_movements.push(make_pair(SECOND, make_pair(id, UL)));
+		if (moved(id))
+			push_move(SECOND, id, UL);
 	}
 
 	
 	//Move all the IDs in priority movement ordered by priority
 	void move_units() {
-		while (not priority_movements.empty()) {
-			mov m = priority_movements.top().second;
-			move(m.first, m.second);
-			priority_movements.pop();
+		for (int p = FIRST; p <= LAST; ++p) {
+			for (mov m : priority_movements[p]) move(m.first, m.second);
+			priority_movements[p].clear();
 	}	}
 
-	//Writes on board what is in each position {Wall, Walker, Enemy, Food, etc.}
-	void write_board() {
-		board = matrix(board_rows(), row(board_cols(), Nothing));
-		for (int i = 0; i < board_rows(); ++i) {
+	//Allocates board and its layers (surrounded by Walls) the first time, they are reused for the
+	//rest of the game. Waste never changes, so the streets are found only once
+	void init_board() {
+		stride = board_cols()+2;
+		board = layer((board_rows()+2)*stride, Wall);
+		rings.clear();
+		int order[4] = {0, 1, 2, 3};
+		for (int i = 0; i < 24; ++i) {
+			copy(order, order+4, orders[i]);
+			next_permutation(order, order+4);
+		}
+		for (int o = 0; o < Nothing; ++o) layers[o].assign((board.size()+63)/64, 0);
+		for (int d = 0; d < DirSize; ++d) {
+			Pos p = Pos(0, 0)+Dir(d);
+			offset[d] = p.i*stride + p.j;
+		}
+		for (int k = 0; k < int(board.size()); ++k) put(layers[Wall], k, true);
+		claimed.assign(board.size(), 0);
+		interest_at.assign(board.size(), 0);
+		interest_stamp.assign(board.size(), 0);
+		unit_in.assign(board.size(), -1);
+		leaving.assign(board.size(), 0);
+		leaving_priority.assign(board.size(), 0);
+		for (int i = 0; i < board_rows(); ++i)
 			for (int j = 0; j < board_cols(); ++j) {
 				Pos p = Pos(i, j);
-				Cell c = cell(p);
-				int id = c.id;
-				if (c.type == Waste) board[i][j] = Wall;
-				else if (c.food) {
-					board[i][j] = Food;
-					food_pos.push_back(p);
-					interest_pos.push_back(p);
-				}
-				else if (id == -1) {if (c.owner != me()) board[i][j] = Square;}
-				else if (unit(id).type == Zombie) {
-					board[i][j] = Walker;
-					walker_pos.push_back(p);
-					interest_pos.push_back(p);
-				}
-				else if (unit(id).type == Dead)	{
-					board[i][j] = Corpse;
-					corpse_pos.push_back(p);
-					interest_pos.push_back(p);
-				}
-				else if (unit(id).type == Alive) {
-					if(unit(id).player == me()) board[i][j] = Ally;
-					else {
-						board[i][j] = Enemy;
-						enemy_pos.push_back(p);
-						interest_pos.push_back(p);
-					}
-	}	} }	}
-	
-	void check_corpses() {
-		for (Pos p : corpse_pos) if (object_crossed(p, Enemy) and not object_crossed(p, Ally)) board[p.i][p.j] = Wall;
+				if (cell(p).type == Waste) continue;
+				streets.push_back(at(p));
+				board[at(p)] = InterestObject;	//Not a valid object, so it will be written
+				put(layers[Wall], at(p), false);
+		}
+		write_graph();
 	}
 
-	void check_walkers() {
-		for (Pos p : walker_pos) {
-			vector<Dir> allDirs = {Down, DR, Right, RU, Up, UL, Left, LD};
-			for (int i = 0; i < 8; ++i) {
-				Dir d = allDirs[i];
-				Pos aux = p+d;
-				if (pos_ok(aux) and not object_in(aux, {Walker, Enemy, Ally, Corpse, Food}))
-					board[aux.i][aux.j] = Wall;
-	}	}	}
+	//Splits the streets into junctions and the corridors between them
+	//Cycles without junctions get one, so every corridor has two ends
+	void write_graph() {
+		junction_of.assign(board.size(), -1);
+		chain_of.assign(board.size(), -1);
+		chain_at.assign(board.size(), 0);
+		for (int k : streets) {
+			int n = 0;
+			for (int i = 0; i < 4; ++i) if (not test(layers[Wall], k+offset[Dirs[i]])) ++n;
+			if (n != 2) add_junction(k);
+		}
+		for (int j = 0; j < int(junctions.size()); ++j) walk_chains(j);
+		for (int k : streets)
+			if (junction_of[k] == -1 and chain_of[k] == -1) {
+				add_junction(k);
+				walk_chains(junctions.size()-1);
+		}
+		//Only worth it if most of the streets are corridors
+		mazy = 3*chain_cells.size() > 2*streets.size();
+	}
+
+	void add_junction(int k) {
+		junction_of[k] = junctions.size();
+		junctions.push_back(k);
+		chains_of.push_back(vector<int>());
+	}
 
-	void check_enemies() {
-		for (Pos p : enemy_pos)
+	//Walks all the corridors that start at the junction j
+	void walk_chains(int j) {
 		for (int i = 0; i < 4; ++i) {
-			Dir d = Dirs[i];
-			Pos aux = p+d;
-			if (pos_ok(aux) and not object_in(aux, {Walker, Enemy, Ally, Corpse, Food}))
-				board[aux.i][aux.j] = Wall;
+			int prev = junctions[j];
+			int k = prev + offset[Dirs[i]];
+			if (test(layers[Wall], k) or chain_of[k] != -1) continue;	//Already walked from its other end
+			if (junction_of[k] != -1 and junction_of[k] < j) continue;
+			Chain c = Chain {j, -1, int(chain_cells.size()), 0};
+			while (junction_of[k] == -1) {
+				chain_of[k] = chains.size();
+				chain_at[k] = ++c.length;
+				chain_cells.push_back(k);
+				int next = k;
+				for (int z = 0; z < 4; ++z) {
+					int aux = k + offset[Dirs[z]];
+					if (aux != prev and not test(layers[Wall], aux)) next = aux;
+				}
+				prev = k;
+				k = next;
+			}
+			c.b = junction_of[k];
+			chains_of[c.a].push_back(chains.size());
+			if (c.b != c.a) chains_of[c.b].push_back(chains.size());
+			chains.push_back(c);
 	}	}
 
+	//The strengths don't change during the round, so the win rates are found only once
+	void write_win_rates() {
+		win_rates.resize(num_players());
+		int my_strength = strength(me());
+		for (int pl = 0; pl < num_players(); ++pl) {
+			int his_strength = strength(pl);
+			if (my_strength == 0 and his_strength == 0) win_rates[pl] = 0.5;
+			else win_rates[pl] = float(my_strength)/(my_strength+his_strength);
+	}	}
+
+	//Writes in kind what is the unit id, found in the cell k, and keeps what the rest of the round
+	//needs of him (one call to unit() for each unit)
+	void set_kind(int id, int k) {
+		if (id >= int(kind.size())) {
+			kind.resize(id+1);
+			unit_k.resize(id+1);
+			unit_player.resize(id+1);
+			unit_zombie.resize(id+1);
+		}
+		Unit u = unit(id);
+		Object o = u.type == Zombie ? Walker : u.type == Dead ? Corpse : u.player == me() ? Ally : Enemy;
+		kind[id] = o;
+		unit_k[id] = k;
+		unit_player[id] = u.player;
+		unit_zombie[id] = u.rounds_for_zombie;
+		all_units.push_back(id);
+		if (o == Ally) my_units.push_back(id);
+	}
+
+	//Writes on board what is in each street {Walker, Enemy, Food, etc.}
+	//Only the cells that have changed since last round are rewritten in layers
+	//The units are found in the streets too, instead of asking for the lists of units of each
+	//player (new vectors every round)
+	void write_board() {
+		if (board.empty()) init_board();
+		write_win_rates();
+		all_units.clear();
+		my_units.clear();
+		for (int k : streets) {
+			Pos p = pos_of(k);
+			Cell c = cell(p);
+			int id = c.id;
+			unit_in[k] = id;
+			if (id != -1) set_kind(id, k);
+			Object o = Nothing;
+			if (c.food) {
+				o = Food;
+				interest_pos.push_back(p);
+			}
+			else if (id == -1) {if (c.owner != me()) o = Square;}
+			else {
+				o = kind[id];
+				if (o == Walker) walker_pos.push_back(p);
+				if (o != Ally) interest_pos.push_back(p);
+			}
+			if (board[k] != o) {
+				if (board[k] < Nothing) put(layers[board[k]], k, false);
+				if (o < Nothing) put(layers[o], k, true);
+				board[k] = o;
+		}	}
+		sort(my_units.begin(), my_units.end());	//In the same order as alive_units
+	}
+
+	//Writes objects, adjacent and crossed from layers with whole words at once
+	//Corpses with Enemies but not Allies next to them are lost, and the empty cells next to a
+	//Walker (also diagonal) or next to an Enemy are too dangerous: they become Walls
+	void write_masks() {
+		bitboard& wall = objects[Wall];
+		wall = layers[Wall];
+		spread(crossed[Enemy], layers[Enemy], false);
+		spread(crossed[Ally], layers[Ally], false);
+		spread(adjacent[Walker], layers[Walker], true);
+		for (size_t i = 0; i < wall.size(); ++i) {
+			word busy = layers[Walker][i] | layers[Enemy][i] | layers[Ally][i] | layers[Corpse][i] | layers[Food][i];
+			wall[i] |= layers[Corpse][i] & crossed[Enemy][i] & ~crossed[Ally][i];
+			wall[i] |= ~busy & (adjacent[Walker][i] | crossed[Enemy][i]);
+		}
+		for (int o = Enemy; o < Nothing; ++o) {
+			objects[o] = layers[o];
+			for (size_t i = 0; i < wall.size(); ++i) objects[o][i] &= ~wall[i];
+			spread(adjacent[o], objects[o], true);
+			spread(crossed[o], objects[o], false);
+	}	}
+
+	//Marks p as a Wall for the rest of the round, what there was in p is not seen anymore
+	void mark_wall(const Pos& p) {
+		int k = at(p);
+#ifdef VERIFY
+		if (reference) original.board[p.i][p.j] = Wall;
+#endif
+		put(objects[Wall], k, true);
+		for (int o = Enemy; o < Nothing; ++o) {
+			if (not test(objects[o], k)) continue;
+			put(objects[o], k, false);
+			for (int d = 0; d < DirSize; ++d) {
+				int aux = k + offset[d];
+				if (not pos_ok(pos_of(aux))) continue;
+				bool adj = false, cross = false;
+				for (int e = 0; e < DirSize; ++e) if (test(objects[o], aux+offset[e])) {
+					adj = true;
+					cross = cross or e == Up or e == Down or e == Right or e == Left;
+				}
+				put(adjacent[o], aux, adj);
+				put(crossed[o], aux, cross);
+	}	}	}
+
 	void reboot() {
+		++round_stamp;	//Forgets units_moved and last_moved of last round
+		//Planning the same round again (BENCHMARK, VERIFY) decides the same and doesn't change the game
+		if (seeded_round != round()) {
+			seeded_round = round();
+			for (unsigned int& s : round_seeds) s = random(1, 1000000000);
+		}
+		seed = round_seeds[0];
+		searches[0].seed = round_seeds[1];
+		searches[1].seed = round_seeds[2];
+		sim_seed = round_seeds[3];
 		interest_pos.clear();
-		last_moved.clear();
-		food_pos.clear();
 		walker_pos.clear();
-		corpse_pos.clear();
-		enemy_pos.clear();
-		units_moved.clear();
-		board.clear();
 		write_board();
-		check_corpses();
-		check_enemies();
-		check_walkers();
+		write_masks();
+#ifdef VERIFY
+		if (reference) check_masks();
+#endif
 	}
 
 	void move_random(int id) {
-		if (units_moved.find(id) != units_moved.end()) return;
-		Pos p = unit(id).pos;
-		vector<int> v = random_permutation(4);
+		if (moved(id)) return;
+		Pos p = unit_pos(id);
+		const int* v = random_order();
 		for (int z = 0; z < 4; ++z) {
 			Dir d = Dirs[v[z]];
-			if (pos_ok(p+d) and not is_wall(p+d) and not object_in(p+d, {Corpse})) {
-				priority_movements.push(make_pair(SECOND, make_pair(id, d)));
-				units_moved.insert(id);
+			if (pos_ok(p+d) and not is_wall(p+d) and not object_in(p+d, {Corpse}) and free_cell(p+d, SECOND)) {
+				push_move(SECOND, id, d);
+				VERIFY_NOTE(id, Wandering, 0);
+				mark(units_moved, id);
+				return;
 	}	}	}
 	
+	enum Phase { Rebooting, Attacking, Waiting, Chasing, Expanding, Wandering, PhaseSize };
+
+#ifdef TRACE
+	FILE* trace_file = nullptr;
+	vector<TraceRecord> trace;	//Records of this round
+	vector<unsigned char> decided_in[LAST+1];	//Phase of each move of priority_movements
+	vector<Pos> aimed;	//Where each unit is going, if aimed_stamp[id] == round_stamp
+	vector<int> aimed_distance;
+	vector<int> aimed_stamp;
+
+	struct Tagger {	//Tags the moves decided until it is destroyed with its phase
+		PLAYER_NAME* player;
+		Phase phase;
+
+		Tagger(PLAYER_NAME* player, Phase phase) : player(player), phase(phase) {}
+
+		~Tagger() {
+			for (int p = FIRST; p <= LAST; ++p)
+				while (player->decided_in[p].size() < player->priority_movements[p].size())
+					player->decided_in[p].push_back(phase);
+		}
+	};
+
+	//Keeps where id is going when it's not the cell next to him
+	void aim(int id, const Pos& target, int distance) {
+		if (id >= int(aimed.size())) {
+			aimed.resize(id+1);
+			aimed_distance.resize(id+1);
+			aimed_stamp.resize(id+1, 0);
+		}
+		aimed[id] = target;
+		aimed_distance[id] = distance;
+		aimed_stamp[id] = round_stamp;
+	}
+
+	//FNV-1a of all the layers, to find the same board in different traces
+	uint64_t digest() {
+		uint64_t h = 14695981039346656037ULL;
+		for (int o = 0; o < Nothing; ++o)
+			for (word w : layers[o]) h = (h ^ w) * 1099511628211ULL;
+		return h;
+	}
+
+	//Appends to TRACE the digest of this round and the moves of priority_movements
+	//Everything is written at once and the file is not buffered, so the players of a game can
+	//share it
+	void write_trace() {
+		if (not trace_file) {
+			trace_file = fopen(TRACE, "ab");
+			if (not trace_file) return;
+			setvbuf(trace_file, nullptr, _IONBF, 0);
+		}
+		trace.clear();
+		TraceRecord r = {};
+		r.round = round();
+		r.id = -1;
+		r.player = me();
+		r.micros = 1000*last_round_time;
+		r.digest = digest();
+		trace.push_back(r);
+		for (int p = FIRST; p <= LAST; ++p)
+			for (size_t m = 0; m < priority_movements[p].size(); ++m) {
+				int id = priority_movements[p][m].first;
+				Dir d = priority_movements[p][m].second;
+				Pos target = unit_pos(id);
+				int distance = 0;
+				if (id < int(aimed.size()) and aimed_stamp[id] == round_stamp) {
+					target = aimed[id];
+					distance = aimed_distance[id];
+				}
+				else if (d != UL) {
+					target = target+d;
+					distance = 1;
+				}
+				r = TraceRecord {};
+				r.round = round();
+				r.id = id;
+				r.player = me();
+				r.phase = m < decided_in[p].size() ? uint8_t(decided_in[p][m]) : uint8_t(PhaseSize);
+				r.priority = p;
+				r.dir = d;
+				r.i = target.i;
+				r.j = target.j;
+				r.distance = distance;
+				trace.push_back(r);
+		}
+		fwrite(trace.data(), sizeof(TraceRecord), trace.size(), trace_file);
+	}
+#endif
+
+#ifdef PROFILE
+
+	struct Counters {	//What has been done during a round
+		double wall[PhaseSize] = {};	//Milliseconds of each phase
+		double cpu[PhaseSize] = {};
+		long long nodes = 0;	//Cells expanded by the searches
+		long long pushes = 0;	//Cells queued by the searches
+		long long cells = 0;	//Calls to cell()
+		long long units = 0;	//Calls to unit()
+	};
+
+	struct Timer {	//Adds to the current round the time until it is destroyed
+		PLAYER_NAME* player;
+		Phase phase;
+		chrono::steady_clock::time_point wall;
+		clock_t cpu;
+
+		Timer(PLAYER_NAME* player, Phase phase) : player(player), phase(phase),
+			wall(chrono::steady_clock::now()), cpu(clock()) {}
+
+		~Timer() {
+			Counters& c = player->counters.back();
+			c.wall[phase] += chrono::duration<double, milli>(chrono::steady_clock::now() - wall).count();
+			c.cpu[phase] += 1000.0*(clock() - cpu)/CLOCKS_PER_SEC;
+		}
+	};
+
+	vector<Counters> counters = vector<Counters>(1);	//One for each round, the last is the current
+
+	//Adds t to the counters of the round and clears it (only when the other threads are done)
+	void add_tally(Tally& t) {
+		counters.back().nodes += t.nodes;
+		counters.back().pushes += t.pushes;
+		t = Tally();
+	}
+
+	Cell cell(const Pos& p) {
+		PROFILE_COUNT(cells);
+		return Player::cell(p);
+	}
+
+	Unit unit(int id) {
+		PROFILE_COUNT(units);
+		return Player::unit(id);
+	}
+
+	//Returns the q-th quantile of v
+	static double quantile(vector<double> v, double q) {
+		sort(v.begin(), v.end());
+		return v[min(v.size()-1, size_t(q*v.size()))];
+	}
+
+	//Writes on cerr the time of each phase (total, percentiles and max of each round), the worst
+	//round and the average of the counters
+	void report() {
+		static const char* names[PhaseSize] = {"reboot", "attack_nearest", "wait_if_worth",
+			"move_nearest_unit", "go_to_square", "move_random"};
+		int rounds = counters.size();
+		vector<double> total(rounds, 0), cpu_total(rounds, 0);
+		for (int r = 0; r < rounds; ++r)
+			for (int f = 0; f < PhaseSize; ++f) {
+				total[r] += counters[r].wall[f];
+				cpu_total[r] += counters[r].cpu[f];
+		}
+		int worst = max_element(total.begin(), total.end()) - total.begin();
+
+		cerr << "Profile of player " << me() << " (" << rounds << " rounds)" << endl;
+		cerr << "  round ms: p50 " << quantile(total, 0.5) << " p90 " << quantile(total, 0.9)
+				 << " p99 " << quantile(total, 0.99) << " worst " << total[worst] << " (round " << worst << ")" << endl;
+		cerr << "  round cpu ms: p50 " << quantile(cpu_total, 0.5) << " p90 " << quantile(cpu_total, 0.9)
+				 << " p99 " << quantile(cpu_total, 0.99) << " worst " << quantile(cpu_total, 1) << endl;
+
+		vector<pair<double, int> > phases;
+		for (int f = 0; f < PhaseSize; ++f) {
+			double sum = 0;
+			for (int r = 0; r < rounds; ++r) sum += counters[r].wall[f];
+			phases.push_back(make_pair(-sum, f));
+		}
+		sort(phases.begin(), phases.end());
+		for (auto ph : phases) {
+			int f = ph.second;
+			vector<double> wall(rounds), cpu(rounds);
+			for (int r = 0; r < rounds; ++r) {
+				wall[r] = counters[r].wall[f];
+				cpu[r] = counters[r].cpu[f];
+			}
+			cerr << "  " << names[f] << ": total " << -ph.first << " ms (cpu " << accumulate(cpu.begin(), cpu.end(), 0.0)
+					 << "), p50 " << quantile(wall, 0.5) << " p90 " << quantile(wall, 0.9)
+					 << " max " << quantile(wall, 1) << ", worst round " << counters[worst].wall[f] << endl;
+		}
+
+		Counters sum;
+		for (const Counters& c : counters) {
+			sum.nodes += c.nodes; sum.pushes += c.pushes;
+			sum.cells += c.cells; sum.units += c.units;
+		}
+		cerr << "  per round: " << sum.nodes/rounds << " nodes, " << sum.pushes/rounds << " pushes, "
+				 << sum.cells/rounds << " cell(), " << sum.units/rounds << " unit()" << endl;
+	}
+#endif
+
+	//Milliseconds since this round started
+	double elapsed() {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - round_start).count();
+	}
+
+	//Decides how much we can search this round
+	//If the CPU used (status) goes ahead of the rounds played or the last round was too slow we
+	//search less, and if it's close to the limit we only do the cheap phases
+	void plan_round() {
+		double cpu = status(me());
+		double played = double(round()+1)/num_rounds();
+		pressure = 0;
+		if (cpu > played + 0.1 or last_round_time > ROUND_TIME) pressure = 1;
+		if (cpu > 0.8 or last_round_time > 2*ROUND_TIME) pressure = 2;
+		if (cpu > 0.95) pressure = 3;
+		SEARCHERS = max(1, MAX_SEARCHERS >> pressure);
+		ROLLOUTS_LEFT = MAX_ROLLOUTS >> pressure;
+	}
+
+	//Returns true if there's still time for a phase that should end before fraction of ROUND_TIME
+	bool in_time(double fraction) {
+#ifdef VERIFY
+		return true;	//Both plans must do the same phases, whatever they take
+#endif
+		return elapsed() < fraction*ROUND_TIME;
+	}
+
+#ifdef BENCHMARK
+	vector<double> bench_time;	//Milliseconds of each plan()
+	vector<long long> bench_allocations;	//Allocations done by each plan()
+	vector<int> bench_units;	//# of my units when each plan() was done
+
+	//Plans this round BENCHMARK-1 times more without moving, so the latency of plan() can be
+	//measured on the real boards without changing the game
+	void benchmark() {
+		vector<Chase> saved = chases;
+		double last = last_round_time;
+		for (int i = 1; i < BENCHMARK; ++i) {
+			long long a = allocations;
+			plan();
+			bench_time.push_back(last_round_time);
+			bench_allocations.push_back(allocations - a);
+			bench_units.push_back(my_units.size());
+			for (int p = FIRST; p <= LAST; ++p) priority_movements[p].clear();
+			chases = saved;
+			last_round_time = last;
+	}	}
+
+	void bench_report() {
+		vector<double> t = bench_time;
+		sort(t.begin(), t.end());
+		int n = t.size();
+		cerr << "Benchmark of player " << me() << " on " << board_rows() << "x" << board_cols() << ", "
+				 << n << " plans" << endl;
+		cerr << "  ms: p50 " << t[n/2] << " p90 " << t[min(n-1, 9*n/10)] << " p99 " << t[min(n-1, 99*n/100)]
+				 << " max " << t[n-1] << endl;
+		cerr << "  allocations per plan: " << accumulate(bench_allocations.begin(), bench_allocations.end(), 0LL)/n
+				 << " (max " << *max_element(bench_allocations.begin(), bench_allocations.end()) << ")" << endl;
+		cerr << "  units per plan: " << accumulate(bench_units.begin(), bench_units.end(), 0LL)/n << endl;
+	}
+#endif
+
+#ifdef VERIFY
+	//The first version of the player, verbatim: verify plans with its write_board (and the check_*
+	//overlays), move_nearest_unit and go_to as the reference of write_masks, move_nearest_unit and
+	//go_to_square
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"	//Movement {1, D}
+	struct Original {
+		PLAYER_NAME& player;
+		unsigned int seed = 1;	//Of random_permutation, so the random numbers of the game are not used
+
+		Original(PLAYER_NAME& player) : player(player) {}
+
+		//What the first version used of the Player
+		Cell cell(const Pos& p) { return player.cell(p); }
+		Unit unit(int id) { return player.unit(id); }
+		bool pos_ok(const Pos& p) { return player.pos_ok(p); }
+		int board_rows() { return player.board_rows(); }
+		int board_cols() { return player.board_cols(); }
+		int me() { return player.me(); }
+		int strength(int pl) { return player.strength(pl); }
+		vector<int> random_permutation(int n) {
+			vector<int> v(n);
+			for (int i = 0; i < n; ++i) v[i] = i;
+			for (int i = n-1; i > 0; --i) swap(v[i], v[player.xorshift(seed) % (i+1)]);
+			return v;
+		}
+
+		struct Movement {
+			int distance;
+			Dir dir;
+			Pos pos;
+		};
+
+		typedef vector<Object> row;
+		typedef vector<row> matrix;
+		
+		typedef pair<int, Dir> mov;
+		typedef pair<int, mov> priority;
+		typedef priority_queue<priority, vector<priority>, greater<priority> > p_q;
+
+		typedef pair<int, int> dist_id;
+		typedef priority_queue<dist_id, vector<dist_id>, greater<dist_id> > searchers_list;
+
+		matrix board;	//Board of the game
+		vector<Pos> food_pos;	//Vector with the food positions at the current round
+		vector<Pos> walker_pos; //Vector with the walkers positions at the current round
+		vector<Pos> corpse_pos; //Vector with the corpse positions at the current round
+		vector<Pos> enemy_pos;
+		vector<Pos> interest_pos;
+		set<int> units_moved;	//Set with the IDs of all my units that has decided his move
+													//Not to move is also a move ;)
+		set<int> last_moved;
+		
+		p_q priority_movements;	//p_q with the movements ordered by priority of movement
+		const vector<Dir> Dirs = {Up, Right, Down, Left}; //All the moves a unit can do
+		int SEARCHERS = MAX_SEARCHERS;
+		int DISTANCE = MAX_DISTANCE;
+
+		// Returns true if o is in position p, false otherwise
+		bool object_in(const Pos& p, const Object& o) {
+			return pos_ok(p) and board[p.i][p.j] == o;
+		}
+		
+		//Returns true if is in position p any of the objects in O
+		bool object_in(const Pos& p, const vector<Object>& O) {
+			for (Object o : O) if (object_in(p, o)) return true;
+			return false;
+		}
+
+		bool is_wall(const Pos& p) {
+			return pos_ok(p) and cell(p).type == Waste;
+		}
+		
+		// Returns true if a unit can move to that position 
+		bool can_move(const Pos& p) {
+			return pos_ok(p) and not object_in(p, Wall);
+		}
+
+		bool object_crossed(const Pos& p, const Object& o) {
+			return	object_in(p+Up, o) or object_in(p+Down, o) or
+							object_in(p+Right, o) or object_in(p+Left, o);
+		}
+		
+		//Returns true if there are Objects o adjacents to p
+		bool object_adjacent(const Pos& p, const Object& o) {
+			return	object_in(p+Up, o) or object_in(p+Down, o)
+							or object_in(p+Right, o) or object_in(p+Left, o)
+							or object_in(p+DR, o) or object_in(p+RU, o)
+							or object_in(p+UL, o) or object_in(p+LD, o); 
+		}
+
+		//id  is the id of an Alive unit
+		//Return true  if id hasn't benn beaten
+		inline bool healthy(int id) {
+			return unit(id).rounds_for_zombie == -1;
+		}
+
+		//Returns true if there's a corridor in p
+		//Used when there's a unit chasing food
+		//If it's a corridor I just need one unit to go
+		bool corridor(const Pos& p) {
+			int n = 0;
+			for (int i = 0; i < 4; ++i) if (can_move(p+Dirs[i])) ++n;
+			return n == 2;
+		}
+		
+		//Returns the inverse Dir to d: {Up -> Down}
+		Dir inverse(const Dir& d) {
+			if (d == Up) return Down;
+			if (d == Right) return Left;
+			if (d == Down) return Up;
+			return Right;
+		}
+		
+		//Returns the probability I have to win in an encounter against enemy
+		float win_rate(int enemy) {
+			int my_strength = strength(me());
+			int	his_strength = strength(enemy); 
+			if (my_strength == 0 and his_strength == 0) return 0.5;
+			return float (my_strength)/(my_strength+his_strength);
+		}
+
+		//Put in Q the pairs <distance, id> of each element in M
+		//The nature of Q orders automatically the values depending on their distance
+		void order_by_distance(searchers_list& Q, const map<int, Movement>& M) {
+			for (auto it = M.begin(); it != M.end(); ++it) {
+				int id = it->first; int distance = it->second.distance;
+				Q.push(make_pair(distance, id));
+		}	}
+
+		//"Moves" (put id in priority_movement) to the nearest object in O
+		void go_to(int id, const vector<Object>& O) {
+			if (units_moved.find(id) != units_moved.end()) return;
+			
+			queue<pair<Pos, Movement>> Q;
+			vector<vector<bool> > visited(board_rows(), vector<bool>(board_cols(), false));
+			
+			Pos p = unit(id).pos;
+			visited[p.i][p.j] = true;
+			vector<int> v = random_permutation(4);
+			for (int i = 0; i < 4; ++i) {
+				Dir D = Dirs[v[i]]; Pos aux = p+D;
+				if (can_move(aux)) {
+					if (object_in(aux, O)) {
+						units_moved.insert(id);
+						priority_movements.push(make_pair(SECOND, make_pair(id, D)));
+						return;
+					}
+					if (not object_adjacent(aux, Walker)) Q.push(make_pair(aux, Movement {1, D}));
+					visited[aux.i][aux.j] = true;
+			}	}
+
+			while (not Q.empty()) {
+				p = Q.front().first;
+				int distance = Q.front().second.distance + 1;
+				Dir D = Q.front().second.dir;	Q.pop();
+				v = random_permutation(4);
+				for (int i = 0; i < 4; ++i) {
+					Dir d = Dirs[v[i]]; Pos aux = p+d;
+					
+					if (can_move(aux) and not visited[aux.i][aux.j] and distance <= DISTANCE) {
+						if (object_in(aux, O)) {
+							if ( not object_in(aux, {Enemy, Corpse})
+									or (object_in(aux, Enemy) and win_rate(unit(cell(aux).id).player) > 0.5)
+									or (object_in(aux, Corpse) and distance < 5)) {
+							units_moved.insert(id);
+							priority_movements.push(make_pair(SECOND, make_pair(id, D)));
+							return;
+					}	}
+						Q.push(make_pair(aux, Movement{distance, D}));
+						visited[aux.i][aux.j] = true;
+		}	}	}	}
+		
+		//Finds the nearest units
+		void bfs_find_units(const Pos& P, map<int, Movement>& M) {
+			if (object_in(P, Wall)) return;
+			int interest = 0;
+			if (board[P.i][P.j] == Food) interest = 0;
+			if (board[P.i][P.j] == Walker) interest = 8;
+			if (board[P.i][P.j] == Enemy) interest = 4;
+			if (board[P.i][P.j] == Corpse) interest = 10;
+			queue<pair<Pos, int>> Q;
+			vector<vector<bool> > visited(board_rows(), vector<bool>(board_cols(), false));
+			int units_found = 0; //The # of units found during this call
+			
+			vector<int> v = random_permutation(4);
+			for (int i = 0; i < 4; ++i) {
+				Dir d = Dirs[v[i]];
+				if (object_in(P+d, Ally) and not object_adjacent(P, Walker)) {
+					int id = cell(P+d).id;
+					if (units_moved.find(id) == units_moved.end()) {
+						Movement m = {1, inverse(d), P};
+						if (M.find(id) == M.end()) M.insert(make_pair(id, m));
+						else M[id] = m;
+						//Not gonna follow this path if it's a corridor (waste of time)
+						if (not corridor(P+d)) Q.push(make_pair(P+d, 1));
+						
+						++units_found; if (units_found > SEARCHERS) return;
+				}	}
+				else if (pos_ok(P+d) and not is_wall(P+d)) Q.push(make_pair(P+d, 1));
+				if (pos_ok(P+d)) visited[(P+d).i][(P+d).j] = true;
+			}
+			visited[P.i][P.j] = true;
+
+			
+			while (not Q.empty()) {
+				Pos p = Q.front().first; int distance = Q.front().second + 1; Q.pop();
+				v = random_permutation(4);
+				for (int z = 0; z < 4; ++z) {
+					Dir d = Dirs[v[z]]; 
+					Pos aux = p+d;
+					int i = aux.i; int j = aux.j;
+					if (distance <= DISTANCE and can_move(aux) and not visited[i][j]) {
+						visited[i][j] = true;
+						int id = cell(aux).id;
+						if (object_in(aux, Ally) and not object_adjacent(p, Walker)) {
+							if (units_moved.find(id) == units_moved.end()) {
+								int D = distance; if (healthy(id)) D += interest;
+								Movement m = {D, inverse(d), P};
+								if (M.find(id) == M.end()) M.insert(make_pair(id, m));
+								else if (M[id].distance > D) M[id] = m;
+
+								//Not gonna follow this path if it's a corridor (waste of time)
+								if (not corridor(aux)) Q.push(make_pair(aux, distance));
+								
+								++units_found; if (units_found > SEARCHERS) return;
+						}	}
+						else Q.push(make_pair(aux, distance));
+		} } } }
+		
+		//Finds the nearest units to each food. 
+		//After calling bfs_find_units, M will store all the units with the DIR to their nearest food
+		//However it will only chase the food that is nearest
+		void move_nearest_unit() {
+			map<int, Movement> M;
+			for (Pos p : interest_pos) bfs_find_units(p, M);
+
+			set<Pos> obj_assigned;
+			searchers_list Q; order_by_distance(Q, M);
+			while (not Q.empty()) { //Takes the unit with minimum distance to an object and it's the only
+				int id = Q.top().second; Q.pop();
+				Movement m = M[id];
+				if (obj_assigned.find(m.pos) == obj_assigned.end()) {
+				obj_assigned.insert(m.pos);
+				units_moved.insert(id);
+				priority_movements.push(make_pair(SECOND, make_pair(id, m.dir)));}
+		}	}
+
+		//Writes on board what is in each position {Wall, Walker, Enemy, Food, etc.}
+		void write_board() {
+			board = matrix(board_rows(), row(board_cols(), Nothing));
+			for (int i = 0; i < board_rows(); ++i) {
+				for (int j = 0; j < board_cols(); ++j) {
+					Pos p = Pos(i, j);
+					Cell c = cell(p);
+					int id = c.id;
+					if (c.type == Waste) board[i][j] = Wall;
+					else if (c.food) {
+						board[i][j] = Food;
+						food_pos.push_back(p);
+						interest_pos.push_back(p);
+					}
+					else if (id == -1) {if (c.owner != me()) board[i][j] = Square;}
+					else if (unit(id).type == Zombie) {
+						board[i][j] = Walker;
+						walker_pos.push_back(p);
+						interest_pos.push_back(p);
+					}
+					else if (unit(id).type == Dead)	{
+						board[i][j] = Corpse;
+						corpse_pos.push_back(p);
+						interest_pos.push_back(p);
+					}
+					else if (unit(id).type == Alive) {
+						if(unit(id).player == me()) board[i][j] = Ally;
+						else {
+							board[i][j] = Enemy;
+							enemy_pos.push_back(p);
+							interest_pos.push_back(p);
+						}
+		}	} }	}
+		
+		void check_corpses() {
+			for (Pos p : corpse_pos) if (object_crossed(p, Enemy) and not object_crossed(p, Ally)) board[p.i][p.j] = Wall;
+		}
+
+		void check_walkers() {
+			for (Pos p : walker_pos) {
+				vector<Dir> allDirs = {Down, DR, Right, RU, Up, UL, Left, LD};
+				for (int i = 0; i < 8; ++i) {
+					Dir d = allDirs[i];
+					Pos aux = p+d;
+					if (pos_ok(aux) and not object_in(aux, {Walker, Enemy, Ally, Corpse, Food}))
+						board[aux.i][aux.j] = Wall;
+		}	}	}
+
+		void check_enemies() {
+			for (Pos p : enemy_pos)
+			for (int i = 0; i < 4; ++i) {
+				Dir d = Dirs[i];
+				Pos aux = p+d;
+				if (pos_ok(aux) and not object_in(aux, {Walker, Enemy, Ally, Corpse, Food}))
+					board[aux.i][aux.j] = Wall;
+		}	}
+
+		void reboot() {
+			interest_pos.clear();
+			last_moved.clear();
+			food_pos.clear();
+			walker_pos.clear();
+			corpse_pos.clear();
+			enemy_pos.clear();
+			units_moved.clear();
+			board.clear();
+			write_board();
+			check_corpses();
+			check_enemies();
+			check_walkers();
+		}
+	};
+#pragma GCC diagnostic pop
+
+	Original original {*this};
+	int mask_difference = -1;	//First cell where write_masks doesn't agree with the original board
+	struct Note {	//Why a unit moves in a plan
+		Phase phase;
+		int distance;	//Of what it chases or of the Square it goes to
+	};
+	vector<Note> notes;
+	vector<vector<int> > chased;	//See original_chase
+	int plans = 0;	//Rounds verified
+	int diverged = 0;	//Rounds in which the reference plan didn't do the same as the fresh one
+	int ties = 0;	//Moves that were different but as near as the reference ones
+	int masks_differ = 0;	//Rounds in which write_masks didn't agree with the original board
+	int later_rounds = 0;	//Rounds in which the plan done didn't do the same as the fresh one
+	int unmoved_rounds = 0;	//Rounds in which a unit had no move in the plan done (never allowed)
+	double fresh_time = 0, reference_time = 0;	//Milliseconds of all the plans of each kind
+	vector<double> speedups;	//Time of the reference plan over the fresh one, each round
+
+	void note(int id, Phase phase, int distance) {
+		if (id >= int(notes.size())) notes.resize(id+1, Note {PhaseSize, -1});
+		notes[id] = Note {phase, distance};
+	}
+
+	//Writes the original board of this round and keeps in mask_difference the first cell where it
+	//isn't what write_masks says (the Walls of objects, the objects of the rest)
+	void check_masks() {
+		original.seed = round_seeds[0] ^ 0x5bd1e995;
+		original.reboot();
+		mask_difference = -1;
+		for (int k : streets) {
+			Pos p = pos_of(k);
+			Object mine = test(objects[Wall], k) ? Wall : board[k];
+			if (original.board[p.i][p.j] != mine) {
+				mask_difference = k;
+				return;
+	}	}	}
+
+	//Takes the moves of the original player as ours
+	void take_original_moves(Phase phase) {
+		while (not original.priority_movements.empty()) {
+			int p = original.priority_movements.top().first;
+			mov m = original.priority_movements.top().second;
+			original.priority_movements.pop();
+			note(m.first, phase, phase == Chasing ? chased[0][m.first] : -1);
+			mark(units_moved, m.first);
+			push_move(p, m.first, m.second);
+	}	}
+
+	inline void sync_original() {
+		original.units_moved.clear();
+		for (int id : my_units) if (moved(id)) original.units_moved.insert(id);
+	}
+
+	//Chasing of the reference plan: the original move_nearest_unit
+	//Which units each object finds depends on the random order of its BFS (a unit is lost if it's
+	//reached first from a cell next to a Walker, and each object stops after SEARCHERS units), so
+	//it's also searched with ORIGINAL_SEEDS seeds before, not timed: chased[r][id] is the distance
+	//of what id chases with the seed r (-1 if nothing), and the first seed is the one played
+	void original_chase() {
+		sync_original();
+		set<int> moved_before = original.units_moved;
+		original.DISTANCE = DISTANCE;
+		original.SEARCHERS = SEARCHERS;
+		auto before = chrono::steady_clock::now();
+		unsigned int seed = original.seed;
+		chased.assign(ORIGINAL_SEEDS, vector<int>(kind.size(), -1));
+		for (int r = 0; r < ORIGINAL_SEEDS; ++r) {
+			original.seed = seed + r;
+			map<int, Original::Movement> M;
+			for (Pos p : original.interest_pos) original.bfs_find_units(p, M);
+			original.seed = seed + r;
+			original.move_nearest_unit();
+			for (; not original.priority_movements.empty(); original.priority_movements.pop()) {
+				int id = original.priority_movements.top().second.first;
+				chased[r][id] = M[id].distance;
+			}
+			original.units_moved = moved_before;
+		}
+		original.seed = seed;
+		round_start += chrono::steady_clock::now() - before;
+		original.move_nearest_unit();
+		take_original_moves(Chasing);
+	}
+
+	//Expanding of the reference plan: the original go_to a Square
+	void original_go_to(int id) {
+		sync_original();
+		original.DISTANCE = territory_limit;
+		original.go_to(id, {Square});
+		take_original_moves(Expanding);
+	}
+
+	//Steps from the unit id to the nearest Square if his first step is d, by the rules of the
+	//original go_to (its BFS doesn't go back through the other cells next to the unit), -1 if he
+	//can't get there
+	int square_distance(int id, Dir d) {
+		Original& o = original;
+		Pos p = unit_pos(id), first = p+d;
+		if (not o.can_move(first)) return -1;
+		if (o.object_in(first, Square)) return 1;
+		if (o.object_adjacent(first, Walker)) return -1;
+		vector<vector<bool> > visited(board_rows(), vector<bool>(board_cols(), false));
+		visited[p.i][p.j] = true;
+		for (int i = 0; i < 4; ++i) if (o.can_move(p+Dirs[i])) visited[(p+Dirs[i]).i][(p+Dirs[i]).j] = true;
+		queue<pair<Pos, int> > Q;
+		Q.push(make_pair(first, 1));
+		while (not Q.empty()) {
+			Pos q = Q.front().first;
+			int distance = Q.front().second + 1;
+			Q.pop();
+			for (int i = 0; i < 4; ++i) {
+				Pos aux = q+Dirs[i];
+				if (not o.can_move(aux) or visited[aux.i][aux.j] or distance > o.DISTANCE) continue;
+				if (o.object_in(aux, Square)) return distance;
+				visited[aux.i][aux.j] = true;
+				Q.push(make_pair(aux, distance));
+		}	}
+		return -1;
+	}
+
+	//Returns true if the move of id in the fresh plan (as in unit_moves, n says why) is one that
+	//the original could do too, only with other random numbers: it chases something as near as
+	//with one of the seeds, or none of them chases it and it goes to a Square as near as any, or
+	//there's no Square to go and it wanders
+	bool tie(int id, int move, const Note& n) {
+		bool unchased = false;
+		for (int r = 0; r < ORIGINAL_SEEDS; ++r) {
+			if (n.phase == Chasing and chased[r][id] == n.distance) return true;
+			unchased = unchased or chased[r][id] == -1;
+		}
+		if (not unchased or (n.phase != Expanding and n.phase != Wandering)) return false;
+		int best = -1;
+		for (int i = 0; i < 4; ++i) {
+			int distance = square_distance(id, Dirs[i]);
+			if (distance != -1 and (best == -1 or distance < best)) best = distance;
+		}
+		if (n.phase == Wandering) return best == -1;
+		return square_distance(id, Dir(move % DirSize)) == best;
+	}
+
+	//Plans this round three times from the same state and seeds: the plan that is done, a fresh
+	//one and a reference one. The fresh plan leaves out what the first version of the player
+	//didn't have: units keep no chases, Walkers are not forecast and cells are not reserved. The
+	//reference plan is fresh too, but its board, chases and Squares are the ones of the original
+	//write_board, move_nearest_unit and go_to (see Original). Then it compares the move (priority
+	//and Dir) of every unit: the reference against the fresh plan tells if the fast searches
+	//decide the same, and the fresh plan against the one done tells what the later changes do,
+	//which is allowed. A different move is a tie if the original could do it too (see tie). The
+	//first difference of each kind is written on cerr, and the speedup of each round is kept
+	void verify() {
+		vector<Chase> saved = chases;
+		double last = last_round_time;
+		++plans;
+		plan();
+		double done_time = last_round_time;
+		vector<int> moves = unit_moves();	//Before the moves are put aside for the replans
+		vector<mov> done[LAST+1];
+		for (int p = FIRST; p <= LAST; ++p) done[p].swap(priority_movements[p]);
+		vector<Chase> done_chases = chases;
+#ifdef TRACE
+		//The trace is of the plan done too: its phases and aims
+		vector<unsigned char> done_in[LAST+1];
+		for (int p = FIRST; p <= LAST; ++p) done_in[p].swap(decided_in[p]);
+		vector<Pos> done_aimed = aimed;
+		vector<int> done_distance = aimed_distance, done_stamp = aimed_stamp;
+		int done_round = round_stamp;
+#endif
+
+		fresh = true;
+		vector<int> warm = replan(saved, last);
+		vector<Note> warm_notes = notes;
+		fresh_time += last_round_time;
+		double fresh_ms = last_round_time;
+		reference = true;
+		vector<int> cold = replan(saved, last);
+		reference = fresh = false;
+		reference_time += last_round_time;
+		speedups.push_back(last_round_time/max(fresh_ms, 1e-6));
+
+		if (mask_difference != -1 and not masks_differ++) {
+			Pos p = pos_of(mask_difference);
+			cerr << "Player " << me() << " writes other masks than the original at round " << round() << ": cell ("
+					 << p.i << ", " << p.j << ")" << endl;
+			dump_board(-1);
+		}
+		int differs = -1;
+		for (int id : my_units)
+			if (warm[id] != cold[id]) {
+				if (tie(id, warm[id], warm_notes[id])) ++ties;
+				else if (differs == -1) differs = id;
+		}
+		if (differs != -1 and not diverged++) {
+			cerr << "Player " << me() << " diverges at round " << round() << ": unit " << differs << " "
+					 << describe(warm[differs]) << why(warm_notes[differs]) << " (reference: " << describe(cold[differs])
+					 << why(notes[differs]) << ")" << endl;
+			dump_board(differs);
+		}
+		differs = first_difference(moves, warm);
+		if (differs != -1 and not later_rounds++)
+			cerr << "Player " << me() << " moves otherwise than the first version at round " << round() << ": unit "
+					 << differs << " " << describe(moves[differs]) << " (fresh plan: " << describe(warm[differs]) << ")" << endl;
+		differs = -1;
+		for (int id : my_units) if (moves[id] == -1 and differs == -1) differs = id;
+		if (differs != -1 and not unmoved_rounds++)
+			cerr << "Player " << me() << " leaves unit " << differs << " without a move at round " << round() << endl;
+
+		for (int p = FIRST; p <= LAST; ++p) priority_movements[p].swap(done[p]);
+#ifdef TRACE
+		for (int p = FIRST; p <= LAST; ++p) decided_in[p].swap(done_in[p]);
+		aimed = done_aimed;
+		aimed_distance = done_distance;
+		aimed_stamp = done_stamp;
+		for (int& stamp : aimed_stamp) if (stamp == done_round) stamp = round_stamp;	//The replans stamped other rounds
+#endif
+		chases = done_chases;
+		last_round_time = done_time;
+		if (round() == num_rounds()-1) {
+			vector<double> x = speedups;
+			sort(x.begin(), x.end());
+			int n = x.size();
+			int slowest = min_element(speedups.begin(), speedups.end()) - speedups.begin();
+			cerr << "Verify of player " << me() << ": " << diverged << " of " << n << " rounds diverged (" << ties
+					 << " ties), " << masks_differ << " with other masks, the later changes moved otherwise in "
+					 << later_rounds << " and left units without a move in " << unmoved_rounds << endl;
+			cerr << "  speedup per round: p50 x" << x[n/2] << " p10 x" << x[n/10] << " min x" << x[0] << " (round "
+					 << slowest << "), total " << reference_time << " ms reference, " << fresh_time << " ms fresh" << endl;
+	}	}
+
+	//Plans the round again from the chases and last round time it had, and returns its moves
+	vector<int> replan(const vector<Chase>& saved, double last) {
+		chases = saved;
+		last_round_time = last;
+		notes.assign(kind.size(), Note {PhaseSize, -1});
+		plan();
+		vector<int> moves = unit_moves();
+		for (int p = FIRST; p <= LAST; ++p) priority_movements[p].clear();
+		return moves;
+	}
+
+	//Move of each unit in priority_movements, as priority*DirSize + Dir (-1 if none)
+	vector<int> unit_moves() {
+		vector<int> moves(kind.size(), -1);
+		for (int p = FIRST; p <= LAST; ++p)
+			for (mov m : priority_movements[p]) if (moves[m.first] == -1) moves[m.first] = p*DirSize + m.second;
+		return moves;
+	}
+
+	//First of my units that doesn't do the same in a and b, -1 if none
+	int first_difference(const vector<int>& a, const vector<int>& b) {
+		for (int id : my_units) if (a[id] != b[id]) return id;
+		return -1;
+	}
+
+	//A move of verify, as priority*DirSize + Dir (-1 if none)
+	string describe(int move) {
+		static const char* names[DirSize] = {"Down", "DR", "Right", "RU", "Up", "UL (stays)", "Left", "LD"};
+		if (move == -1) return "doesn't move";
+		return string("goes ") + names[move % DirSize] + " with priority " + to_string(move / DirSize);
+	}
+
+	//Why a unit moves, for describe
+	string why(const Note& n) {
+		static const char* names[PhaseSize+1] = {"rebooting", "attacking", "waiting", "chasing", "expanding", "wandering", ""};
+		if (n.phase == PhaseSize) return "";
+		return string(" ") + names[n.phase] + (n.distance == -1 ? "" : " at " + to_string(n.distance));
+	}
+
+	//Writes board on cerr, with the unit id as *
+	void dump_board(int id) {
+		static const char symbol[] = "#EZACF. ";	//By Object
+		for (int i = 0; i < board_rows(); ++i) {
+			for (int j = 0; j < board_cols(); ++j) {
+				int k = at(Pos(i, j));
+				cerr << (unit_in[k] == id and id != -1 ? '*' : symbol[board[k]]);
+			}
+			cerr << endl;
+	}	}
+#endif
+
+	//Decides the moves of this round and leaves them in priority_movements
+	void plan() {
+		round_start = chrono::steady_clock::now();
+#ifdef TRACE
+		for (int p = FIRST; p <= LAST; ++p) decided_in[p].clear();
+#endif
+		{
+			PROFILE_PHASE(Rebooting);
+			reboot();
+			if (not fresh) write_threats();
+		}
+		plan_round();
+		
+		//Phases from the most to the least valuable, the searches are skipped when out of time
+		{
+			PROFILE_PHASE(Attacking);
+			for (int id : my_units) attack_nearest(id);
+		}
+		{
+			PROFILE_PHASE(Waiting);
+			for (int id : my_units) wait_if_worth(id);
+		}
+#ifdef THREADS
+		//The territory doesn't depend on who chases what, so it's searched meanwhile
+		if (pressure < 2) expander.run([this] { write_territory(MAX_TERRITORY >> (3*pressure)); });
+#endif
+		if (pressure < 3 and in_time(0.5)) {
+			PROFILE_PHASE(Chasing);
+			DISTANCE = MAX_DISTANCE >> pressure;
+			move_nearest_unit();
+		}
+#ifdef THREADS
+		if (pressure < 2) expander.wait();
+#endif
+		if (pressure < 2 and in_time(0.8)) {
+			PROFILE_PHASE(Expanding);
+#ifndef THREADS
+			write_territory(MAX_TERRITORY >> (3*pressure));
+#endif
+			for (int id : my_units) go_to_square(id);
+		}
+		{
+			PROFILE_PHASE(Wandering);
+			for (int id : my_units) move_random(id);
+		}
+#ifdef PROFILE
+		for (Search& S : searches) add_tally(S.tally);
+		add_tally(territory_tally);
+#endif
+		last_round_time = elapsed();
+	}
+
 	/**
    * Play method, invoked once per each round.
    */
 
   virtual void play () {
-		reboot();
-		vector<int> my_units = alive_units(me());
-		
-		for (int id : my_units) attack_nearest(id);
-		for (int id : my_units) wait_if_worth(id);
-		DISTANCE = MAX_DISTANCE;
-		move_nearest_unit();
-		DISTANCE = 1000;
-		for (int id : my_units) go_to(id, {Square});
-		for (int id : my_units) move_random(id);
-		
+#ifdef BENCHMARK
+		benchmark();
+#endif
+#ifdef VERIFY
+		verify();
+#else
+		plan();
+#endif
+#ifdef TRACE
+		write_trace();
+#endif
 		move_units();
+#ifdef BENCHMARK
+		if (round() == num_rounds()-1) bench_report();
+#endif
+#ifdef PROFILE
+		if (round() == num_rounds()-1) report();
+		else counters.push_back(Counters());
+#endif
   }
 
 };
@@ -0,0 +1,146 @@
+#!/bin/bash
+# Plays many seeded games between variants of program.cc on all cores, with the stand-in game of
+# bench/bench.cc (its -m matches) or, with -G, with the game of the course
+#	./tournament.sh [-g games] [-j jobs] [-b bench_options] [-G] [-d game_dir] [-i config] [-o results] NAME[=FLAGS]...
+# e.g.	./tournament.sh -g 2000 -b "-s 60,100 -w 0.1,maze" Base Wide="-DMAX_SEARCHERS=8 -DMAX_DISTANCE=80"
+# Each variant is program.cc compiled with its name as PLAYER_NAME and its -D flags (see the
+# #ifndef at the top of program.cc). bench_options are the board options of bench.cc (-s -w -u -z
+# -f -r -t), the seed of each game picks its board. game_dir is where the Makefile of the game is
+# and config its board (only with -G, whose variants are compiled with PROFILE for the CPU times).
+# The 4 seats go round the variants and move one seat each game. Writes a line for each seat of
+# each game in results (seed, seat, variant, score, share of the top score, p50 and p99 CPU ms of
+# its rounds) and a summary of each variant (the CPU times are means over its games).
+set -e
+
+games=100
+jobs=$(nproc)
+bench_options=
+game=
+dir=.
+config=default.cnf
+out=results.tsv
+while getopts "g:j:b:Gd:i:o:" opt; do
+	case $opt in
+		g) games=$OPTARG ;;
+		j) jobs=$OPTARG ;;
+		b) bench_options=$OPTARG ;;
+		G) game=1 ;;
+		d) dir=$OPTARG ;;
+		i) config=$OPTARG ;;
+		o) out=$(realpath "$OPTARG") ;;
+		*) exit 1 ;;
+	esac
+done
+shift $((OPTIND-1))
+if [ $# -eq 0 ]; then
+	sed -n '2,12p' "$0" >&2
+	exit 1
+fi
+[ "$out" = results.tsv ] && out=$(realpath results.tsv)
+
+repo=$(dirname "$(realpath "$0")")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# Writes the defines of the variant $1=flags, the ones in $2 first
+defines() {
+	local v=$1 name=${1%%=*} flags= f
+	[[ $v == *=* ]] && flags=${v#*=}
+	echo "#define PLAYER_NAME $name"
+	for f in $2 $flags; do
+		f=${f#-D}
+		[[ $f == *=* ]] && echo "#define ${f%%=*} ${f#*=}" || echo "#define $f"
+	done
+}
+
+names=()
+for v in "$@"; do names+=("${v%%=*}"); done
+
+if [ -z "$game" ]; then
+	# All the variants are in the same bench binary, each one is registered with its name
+	for v in "$@"; do
+		{
+			defines "$v"
+			echo "#include \"$repo/program.cc\""
+		} > "$tmp/${v%%=*}.cc"
+	done
+	sources=()
+	for name in "${names[@]}"; do sources+=("$tmp/$name.cc"); done
+	g++ -std=c++17 -O2 -I"$repo/bench" -o "$tmp/bench" "$repo/bench/bench.cc" "${sources[@]}"
+else
+	cd "$dir"
+	trap 'rm -rf "$tmp" AItour*.cc AItour*.o tournament_program.hh' EXIT
+	# program.cc is copied next to Player.hh so that its includes are found
+	cp "$repo/program.cc" tournament_program.hh
+	for v in "$@"; do
+		{
+			defines "$v" PROFILE
+			echo '#include "tournament_program.hh"'
+		} > "AItour${v%%=*}.cc"
+	done
+	make -s Game
+fi
+
+# Writes $tmp/seed.tsv with the results of the game of seed
+play() {
+	local seed=$1
+	if [ -z "$game" ]; then
+		if ! "$tmp/bench" -m -g 1 -S "$seed" $bench_options > "$tmp/$seed.out" 2> "$tmp/$seed.log"; then
+			echo "game $seed failed:" >&2
+			tail -n 5 "$tmp/$seed.log" >&2
+		else
+			tail -n +2 "$tmp/$seed.out" > "$tmp/$seed.tsv"
+		fi
+		rm -f "$tmp/$seed.out" "$tmp/$seed.log"
+		return
+	fi
+	local players=() s
+	for s in 0 1 2 3; do players+=("${names[$(( (seed+s) % ${#names[@]} ))]}"); done
+	if ! ./Game "${players[@]}" -s "$seed" -i "$config" -o "$tmp/$seed.res" 2> "$tmp/$seed.log"; then
+		echo "game $seed failed:" >&2
+		tail -n 5 "$tmp/$seed.log" >&2
+		return
+	fi
+	awk -v seed="$seed" -v players="${players[*]}" '
+		BEGIN { n = split(players, name, " ") }
+		/got score/ { score[++scored] = $NF }
+		/^Profile of player/ { seat = $4 + 1 }
+		/round cpu ms:/ { p50[seat] = $5; p99[seat] = $9 }
+		END {
+			if (scored != n) exit
+			top = 0
+			for (s = 1; s <= n; ++s) if (score[s] > top) top = score[s]
+			for (s = 1; s <= n; ++s) if (score[s] == top) ++tied
+			for (s = 1; s <= n; ++s)
+				printf "%d\t%d\t%s\t%d\t%.3f\t%s\t%s\n", seed, s-1, name[s], score[s],
+					score[s] == top ? 1/tied : 0, p50[s], p99[s]
+		}' "$tmp/$seed.log" > "$tmp/$seed.tsv"
+	rm -f "$tmp/$seed.res" "$tmp/$seed.log"
+}
+
+start=$(date +%s.%N)
+for seed in $(seq 1 "$games"); do
+	while [ "$(jobs -rp | wc -l)" -ge "$jobs" ]; do wait -n; done
+	play "$seed" &
+done
+wait
+end=$(date +%s.%N)
+
+printf "seed\tseat\tvariant\tscore\ttop\tp50_cpu_ms\tp99_cpu_ms\n" > "$out"
+for seed in $(seq 1 "$games"); do cat "$tmp/$seed.tsv" 2> /dev/null || true; done >> "$out"
+
+awk -F '\t' -v seconds="$(awk "BEGIN { print $end - $start }")" '
+	NR > 1 {
+		++seats[$3]; top[$3] += $5; score[$3] += $4
+		if ($6 != "") { ++timed[$3]; p50[$3] += $6; p99[$3] += $7 }
+		games[$1] = 1
+	}
+	END {
+		n = length(games)
+		printf "%d games in %.0f s (%.0f games/hour)\n", n, seconds, (seconds > 0 ? 3600*n/seconds : 0)
+		printf "%-20s %8s %8s %10s %10s %10s\n", "variant", "seats", "wins", "score", "p50 cpu", "p99 cpu"
+		for (v in seats)
+			printf "%-20s %8d %7.1f%% %10.1f %10.3f %10.3f\n", v, seats[v], 100*top[v]/seats[v],
+				score[v]/seats[v], timed[v] ? p50[v]/timed[v] : 0,
+				timed[v] ? p99[v]/timed[v] : 0
+	}' "$out"
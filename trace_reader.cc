@@ -0,0 +1,105 @@
+//Reads the traces written by program.cc compiled with TRACE
+//	g++ -O2 -o trace_reader trace_reader.cc
+//	./trace_reader [-r round] [-u id] [-p player] [-f phase] [-q] trace.bin...
+//Prints the decisions that match the filters (all of them if there's none) and a summary
+//The traces are mapped in memory, so thousands of games can be read at once
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+struct TraceRecord {	//Same as in program.cc
+	int32_t round;
+	int32_t id;
+	uint8_t player;
+	uint8_t phase;
+	uint8_t priority;
+	uint8_t dir;
+	int16_t i, j;
+	int32_t distance;
+	uint32_t micros;
+	uint64_t digest;
+};
+static_assert(sizeof(TraceRecord) == 32, "program.cc writes records of 32 bytes");
+
+const char* phases[] = {"reboot", "attack_nearest", "wait_if_worth", "move_nearest_unit", "go_to_square",
+	"move_random", "?"};
+const char* priorities[] = {"FIRST", "SECOND", "LAST"};
+const char* dirs[] = {"Down", "DR", "Right", "RU", "Up", "UL", "Left", "LD"};
+const int PHASES = sizeof(phases)/sizeof(phases[0]);
+
+int main(int argc, char** argv) {
+	int round = -1, id = -1, player = -1, phase = -1;
+	bool quiet = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:u:p:f:q")) != -1) {
+		if (opt == 'r') round = atoi(optarg);
+		else if (opt == 'u') id = atoi(optarg);
+		else if (opt == 'p') player = atoi(optarg);
+		else if (opt == 'f') phase = atoi(optarg);
+		else if (opt == 'q') quiet = true;
+		else {
+			fprintf(stderr, "usage: %s [-r round] [-u id] [-p player] [-f phase] [-q] trace...\n", argv[0]);
+			return 1;
+	}	}
+
+	long long decisions = 0, matched = 0, plans = 0;
+	long long by_phase[PHASES][3] = {};
+	double micros = 0;
+	uint32_t worst = 0;
+	map<uint64_t, int> boards;	//Times each digest is seen
+	for (int f = optind; f < argc; ++f) {
+		int fd = open(argv[f], O_RDONLY);
+		struct stat st;
+		if (fd == -1 or fstat(fd, &st) == -1) {
+			perror(argv[f]);
+			return 1;
+		}
+		size_t n = st.st_size/sizeof(TraceRecord);
+		if (n == 0) {
+			close(fd);
+			continue;
+		}
+		void* data = mmap(nullptr, n*sizeof(TraceRecord), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			perror(argv[f]);
+			return 1;
+		}
+		const TraceRecord* records = (const TraceRecord*)data;
+		for (size_t k = 0; k < n; ++k) {
+			const TraceRecord& r = records[k];
+			if ((round != -1 and r.round != round) or (player != -1 and r.player != player)) continue;
+			if (r.id == -1) {
+				++plans;
+				micros += r.micros;
+				if (r.micros > worst) worst = r.micros;
+				++boards[r.digest];
+				continue;
+			}
+			++decisions;
+			if ((id != -1 and r.id != id) or (phase != -1 and r.phase != phase)) continue;
+			++matched;
+			++by_phase[min(int(r.phase), PHASES-1)][min(int(r.priority), 2)];
+			if (not quiet)
+				printf("%s round %d player %d unit %d: %s %s by %s to (%d,%d) at %d\n", argv[f], r.round, r.player,
+					r.id, priorities[min(int(r.priority), 2)], r.dir < 8 ? dirs[r.dir] : "?",
+					phases[min(int(r.phase), PHASES-1)], r.i, r.j, r.distance);
+		}
+		munmap(data, n*sizeof(TraceRecord));
+	}
+
+	printf("%lld plans (%zu different boards), mean %.1f us, worst %u us\n", plans, boards.size(),
+		plans ? micros/plans : 0, worst);
+	printf("%lld of %lld decisions matched\n", matched, decisions);
+	for (int f = 0; f < PHASES; ++f)
+		for (int p = 0; p < 3; ++p)
+			if (by_phase[f][p]) printf("  %s %s: %lld\n", phases[f], priorities[p], by_phase[f][p]);
+}